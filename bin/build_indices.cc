@@ -0,0 +1,132 @@
+#include <string>
+
+#include "glog/logging.h"
+#include "graph/compact_csr.h"
+#include "graph/compressed_csr.h"
+#include "graph/schema.h"
+#include "graph/vertex_map.h"
+#include "property/table.h"
+
+// Encodes the global and, if present, local neighbor lists of a compressed
+// csr, or writes the offsets of a compact one.
+bool dump_csr_layout(const std::string& csr_prefix, ladder::CsrLayout layout) {
+  if (layout == ladder::CsrLayout::kCompact) {
+    if (!ladder::CompactCsr::dump(csr_prefix)) {
+      LOG(ERROR) << "failed to dump compact layout of " << csr_prefix;
+      return false;
+    }
+    return true;
+  }
+  if (layout != ladder::CsrLayout::kCompressed) {
+    return true;
+  }
+  for (auto encoding :
+       {ladder::NeighborEncoding::kGlobal, ladder::NeighborEncoding::kLocal}) {
+    std::string nbrs_fname = ladder::neighbor_list_fname(csr_prefix, encoding);
+    if (!ladder::file_exists(nbrs_fname)) {
+      continue;
+    }
+    if (!ladder::CompressedCsr::dump(csr_prefix, encoding)) {
+      LOG(ERROR) << "failed to dump compressed lists of " << csr_prefix;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Builds the vertex map hash tables, the secondary property indices, the zone
+// maps and sorted indices of temporal columns and the layouts of compact and
+// compressed csrs of a partition once and stores them next to their data, so
+// that GraphDB::open can load or map them directly.
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " <prefix> <partition_id>"
+              << std::endl;
+    return 1;
+  }
+  std::string prefix = argv[1];
+  int partition_id = atoi(argv[2]);
+
+  ladder::Schema schema;
+  schema.open(prefix + "/graph_schema/schema.json");
+
+  std::string vm_prefix = prefix + "/graph_data_bin/partition_" +
+                          std::to_string(partition_id) + "/vm";
+  ladder::VertexMap vertex_map;
+  vertex_map.open(vm_prefix, schema.vertex_label_num(),
+                  ladder::StorageStrategy::kMemory);
+  if (!vertex_map.dump_indices(vm_prefix)) {
+    LOG(ERROR) << "failed to dump indices of partition " << partition_id;
+    return 1;
+  }
+
+  std::string vp_prefix = prefix + "/graph_data_bin/partition_" +
+                          std::to_string(partition_id) + "/vp_";
+  for (ladder::label_t label = 0; label < schema.vertex_label_num();
+       ++label) {
+    const auto& header = schema.get_vertex_header(label);
+    std::string table_prefix = vp_prefix + std::to_string(label);
+    ladder::Table table;
+    table.init(header);
+    for (size_t col_i = 0; col_i < header.size(); ++col_i) {
+      bool indexed = schema.vertex_prop_is_indexed(label, col_i);
+      bool zone_map = schema.vertex_prop_has_zone_map(label, col_i);
+      bool sorted_index = schema.vertex_prop_has_sorted_index(label, col_i);
+      if (!indexed && !zone_map && !sorted_index) {
+        continue;
+      }
+      table.open_column(table_prefix, col_i, ladder::StorageStrategy::kMmap);
+      if (indexed) {
+        table.open_index(table_prefix, col_i,
+                         ladder::StorageStrategy::kMemory);
+        if (!table.dump_index(table_prefix, col_i)) {
+          LOG(ERROR) << "failed to dump index of " << header[col_i].first;
+          return 1;
+        }
+      }
+      if (zone_map) {
+        table.open_zone_map(table_prefix, col_i,
+                            ladder::StorageStrategy::kMemory);
+        if (!table.dump_zone_map(table_prefix, col_i)) {
+          LOG(ERROR) << "failed to dump zone map of " << header[col_i].first;
+          return 1;
+        }
+      }
+      if (sorted_index) {
+        table.open_sorted_index(table_prefix, col_i,
+                                ladder::StorageStrategy::kMemory);
+        if (!table.dump_sorted_index(table_prefix, col_i)) {
+          LOG(ERROR) << "failed to dump sorted index of "
+                     << header[col_i].first;
+          return 1;
+        }
+      }
+    }
+  }
+  std::string csr_prefix = prefix + "/graph_data_bin/partition_" +
+                           std::to_string(partition_id) + "/";
+  for (ladder::label_t src = 0; src < schema.vertex_label_num(); ++src) {
+    for (ladder::label_t edge = 0; edge < schema.edge_label_num(); ++edge) {
+      for (ladder::label_t dst = 0; dst < schema.vertex_label_num(); ++dst) {
+        if (!schema.exist_edge_triplet(src, edge, dst)) {
+          continue;
+        }
+        std::string suffix = std::to_string(src) + "_" +
+                             std::to_string(edge) + "_" + std::to_string(dst);
+        if (!schema.oe_is_single(src, edge, dst) &&
+            !dump_csr_layout(csr_prefix + "oe_" + suffix,
+                             schema.oe_layout(src, edge, dst))) {
+          return 1;
+        }
+        if (!schema.ie_is_single(src, edge, dst) &&
+            !dump_csr_layout(csr_prefix + "ie_" + suffix,
+                             schema.ie_layout(src, edge, dst))) {
+          return 1;
+        }
+      }
+    }
+  }
+  LOG(INFO) << "dumped indices of partition " << partition_id;
+
+  return 0;
+}
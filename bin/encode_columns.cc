@@ -0,0 +1,150 @@
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "graph/schema.h"
+#include "property/column.h"
+#include "property/encoding.h"
+#include "property/types.h"
+#include "utils.h"
+
+namespace {
+
+std::string partition_prefix(const std::string& prefix, int partition_id) {
+  return prefix + "/graph_data_bin/partition_" +
+         std::to_string(partition_id);
+}
+
+bool parse_encoding(const std::string& name,
+                    ladder::ColumnEncoding& encoding) {
+  for (auto candidate :
+       {ladder::ColumnEncoding::kPlain, ladder::ColumnEncoding::kFor,
+        ladder::ColumnEncoding::kRle, ladder::ColumnEncoding::kDict}) {
+    if (name == ladder::encoding_name(candidate)) {
+      encoding = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Encodes the plain column file at col_prefix, with the smallest encoding
+// unless one is forced.
+template <typename RAW_T>
+bool encode_file(const std::string& col_prefix, bool forced,
+                 ladder::ColumnEncoding forced_encoding) {
+  std::vector<RAW_T> values;
+  ladder::load_from_file(col_prefix, values);
+  ladder::ColumnEncoder<RAW_T> encoder(values);
+  ladder::ColumnEncoding encoding =
+      forced ? forced_encoding : encoder.choose();
+  if (!encoder.dump(col_prefix, encoding)) {
+    LOG(ERROR) << "failed to encode " << col_prefix;
+    return false;
+  }
+  LOG(INFO) << col_prefix << ": " << ladder::encoding_name(encoding) << ", "
+            << encoder.encoded_size(ladder::ColumnEncoding::kPlain) << " -> "
+            << encoder.encoded_size(encoding) << " bytes";
+  return true;
+}
+
+bool encode_column(const std::string& col_prefix, ladder::DataType type,
+                   bool forced, ladder::ColumnEncoding forced_encoding) {
+  switch (type) {
+  case ladder::DataType::kInt32:
+  case ladder::DataType::kDate:
+    return encode_file<int32_t>(col_prefix, forced, forced_encoding);
+  case ladder::DataType::kUInt32:
+    return encode_file<uint32_t>(col_prefix, forced, forced_encoding);
+  case ladder::DataType::kInt64:
+  case ladder::DataType::kDateTime:
+    return encode_file<int64_t>(col_prefix, forced, forced_encoding);
+  case ladder::DataType::kUInt64:
+  case ladder::DataType::kID:
+    return encode_file<uint64_t>(col_prefix, forced, forced_encoding);
+  case ladder::DataType::kString:
+    if (!ladder::StringColumn::dump_narrow_offsets(col_prefix)) {
+      LOG(ERROR) << "failed to compact " << col_prefix;
+      return false;
+    }
+    return true;
+  default:
+    // Floating point and low-cardinality string columns stay as they are.
+    return true;
+  }
+}
+
+bool encode_table(
+    const std::string& table_prefix,
+    const std::vector<std::pair<std::string, ladder::DataType>>& header,
+    bool forced, ladder::ColumnEncoding forced_encoding) {
+  for (size_t col_i = 0; col_i < header.size(); ++col_i) {
+    std::string col_prefix = table_prefix + "_col_" + std::to_string(col_i);
+    if (!encode_column(col_prefix, header[col_i].second, forced,
+                       forced_encoding)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+// Writes lightweight encodings (see property/encoding.h) of the integer and
+// temporal vertex and edge property columns of a partition next to their
+// plain files. Each column gets the smallest of plain, frame-of-reference,
+// run-length and dictionary encoding unless one is given, run-length only if
+// its runs are long, see ColumnEncoder::choose. String columns get
+// the 32-bit offsets StringColumn would otherwise build at every open.
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <prefix> <partition_id> [plain|for|rle|dict]" << std::endl;
+    return 1;
+  }
+  std::string prefix = argv[1];
+  int partition_id = atoi(argv[2]);
+  bool forced = argc > 3;
+  ladder::ColumnEncoding forced_encoding = ladder::ColumnEncoding::kPlain;
+  if (forced && !parse_encoding(argv[3], forced_encoding)) {
+    std::cerr << "Unknown encoding " << argv[3] << std::endl;
+    return 1;
+  }
+
+  ladder::Schema schema;
+  schema.open(prefix + "/graph_schema/schema.json");
+  ladder::label_t vertex_label_num = schema.vertex_label_num();
+  ladder::label_t edge_label_num = schema.edge_label_num();
+  std::string bin_prefix = partition_prefix(prefix, partition_id);
+
+  for (ladder::label_t label = 0; label < vertex_label_num; ++label) {
+    if (!encode_table(bin_prefix + "/vp_" + std::to_string(label),
+                      schema.get_vertex_header(label), forced,
+                      forced_encoding)) {
+      return 1;
+    }
+  }
+
+  for (ladder::label_t src = 0; src < vertex_label_num; ++src) {
+    for (ladder::label_t edge = 0; edge < edge_label_num; ++edge) {
+      for (ladder::label_t dst = 0; dst < vertex_label_num; ++dst) {
+        if (!schema.exist_edge_triplet(src, edge, dst)) {
+          continue;
+        }
+        std::string suffix = std::to_string(src) + "_" +
+                             std::to_string(edge) + "_" +
+                             std::to_string(dst);
+        const auto& header = schema.get_edge_header(src, edge, dst);
+        if (!encode_table(bin_prefix + "/iep_" + suffix, header, forced,
+                          forced_encoding) ||
+            !encode_table(bin_prefix + "/oep_" + suffix, header, forced,
+                          forced_encoding)) {
+          return 1;
+        }
+      }
+    }
+  }
+  LOG(INFO) << "encoded columns of partition " << partition_id;
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "graph/csr.h"
+#include "graph/schema.h"
+#include "graph/vertex_map.h"
+#include "utils.h"
+
+namespace {
+
+std::string partition_prefix(const std::string& prefix, int partition_id) {
+  return prefix + "/graph_data_bin/partition_" + std::to_string(partition_id);
+}
+
+// The first pass lays _lnbrs out like _nbrs, so its lists are no longer
+// sorted until the last step sorts them again.
+bool clear_local_sorted(const std::string& csr_prefix) {
+  std::vector<size_t> meta;
+  ladder::load_from_file(csr_prefix + "_meta", meta);
+  if (!ladder::lists_are_sorted(meta, ladder::NeighborEncoding::kLocal)) {
+    return true;
+  }
+  meta[1] &= ~ladder::sorted_lists_flag(ladder::NeighborEncoding::kLocal);
+  return ladder::dump_to_file(csr_prefix + "_meta", meta.data(), meta.size());
+}
+
+// Rewrites the neighbors of one adjacency file that are owned by
+// owner_id into partition-local ids. Neighbors owned by other partitions are
+// left untouched, and filled in by their own pass.
+bool encode_file(const std::string& csr_prefix, int owner_id,
+                 int partition_num, const ladder::VertexMap& vertex_map) {
+  std::vector<ladder::gid_t> nbrs, lnbrs;
+  ladder::load_from_file(csr_prefix + "_nbrs", nbrs);
+  if (owner_id == 0) {
+    lnbrs.resize(nbrs.size(), std::numeric_limits<ladder::gid_t>::max());
+  } else {
+    ladder::load_from_file(csr_prefix + "_lnbrs", lnbrs);
+    if (lnbrs.size() != nbrs.size()) {
+      LOG(ERROR) << "size mismatch of " << csr_prefix << "_lnbrs";
+      return false;
+    }
+  }
+
+  std::vector<size_t> positions;
+  std::vector<ladder::gid_t> owned;
+  for (size_t i = 0; i < nbrs.size(); ++i) {
+    // max() marks an empty slot of a single csr.
+    if (nbrs[i] != std::numeric_limits<ladder::gid_t>::max() &&
+        ladder::get_server(nbrs[i], partition_num) == owner_id) {
+      positions.push_back(i);
+      owned.push_back(nbrs[i]);
+    }
+  }
+  std::vector<ladder::vertex_t> internal_ids(owned.size());
+  size_t found = vertex_map.get_internal_ids(owned.data(), owned.size(),
+                                             internal_ids.data());
+  // A missing neighbor would be left as an empty slot, which readers skip.
+  if (found != owned.size()) {
+    LOG(ERROR) << owned.size() - found << " neighbors of " << csr_prefix
+               << " are missing on partition " << owner_id;
+    return false;
+  }
+  for (size_t i = 0; i < owned.size(); ++i) {
+    lnbrs[positions[i]] = ladder::VertexMap::encode_local_id(
+        vertex_map.get_label_id(owned[i]), owner_id, internal_ids[i]);
+  }
+  if (owner_id == 0 && !clear_local_sorted(csr_prefix)) {
+    return false;
+  }
+  return ladder::dump_to_file(csr_prefix + "_lnbrs", lnbrs.data(),
+                              lnbrs.size());
+}
+
+}  // namespace
+
+// Writes a partition-local copy (_lnbrs) of every adjacency list of every
+// partition, to be opened with NeighborEncoding::kLocal, and sorts both
+// copies of the lists the schema declares sorted. Only one vertex map
+// is resident at a time: each pass loads the map of one owner partition and
+// resolves the neighbors it owns across all partitions.
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " <prefix> <partition_num>"
+              << std::endl;
+    return 1;
+  }
+  std::string prefix = argv[1];
+  int partition_num = atoi(argv[2]);
+
+  ladder::Schema schema;
+  schema.open(prefix + "/graph_schema/schema.json");
+  ladder::label_t vertex_label_num = schema.vertex_label_num();
+  ladder::label_t edge_label_num = schema.edge_label_num();
+
+  std::vector<std::string> csr_names, sorted_csr_names;
+  for (ladder::label_t src = 0; src < vertex_label_num; ++src) {
+    for (ladder::label_t edge = 0; edge < edge_label_num; ++edge) {
+      for (ladder::label_t dst = 0; dst < vertex_label_num; ++dst) {
+        if (schema.exist_edge_triplet(src, edge, dst)) {
+          std::string suffix = std::to_string(src) + "_" +
+                               std::to_string(edge) + "_" +
+                               std::to_string(dst);
+          csr_names.push_back("ie_" + suffix);
+          csr_names.push_back("oe_" + suffix);
+          if (schema.ie_is_sorted(src, edge, dst) &&
+              !schema.ie_is_single(src, edge, dst)) {
+            sorted_csr_names.push_back("ie_" + suffix);
+          }
+          if (schema.oe_is_sorted(src, edge, dst) &&
+              !schema.oe_is_single(src, edge, dst)) {
+            sorted_csr_names.push_back("oe_" + suffix);
+          }
+        }
+      }
+    }
+  }
+
+  for (int owner_id = 0; owner_id < partition_num; ++owner_id) {
+    ladder::VertexMap vertex_map;
+    vertex_map.open(partition_prefix(prefix, owner_id) + "/vm",
+                    vertex_label_num, ladder::StorageStrategy::kMmap);
+    for (int partition_id = 0; partition_id < partition_num; ++partition_id) {
+      for (auto& name : csr_names) {
+        std::string csr_prefix =
+            partition_prefix(prefix, partition_id) + "/" + name;
+        if (!encode_file(csr_prefix, owner_id, partition_num, vertex_map)) {
+          return 1;
+        }
+      }
+    }
+    LOG(INFO) << "encoded neighbors owned by partition " << owner_id;
+  }
+
+  // Lists of sorted triplets are sorted once here, in both encodings, instead
+  // of at every GraphDB::open.
+  for (int partition_id = 0; partition_id < partition_num; ++partition_id) {
+    for (auto& name : sorted_csr_names) {
+      std::string csr_prefix =
+          partition_prefix(prefix, partition_id) + "/" + name;
+      for (auto encoding : {ladder::NeighborEncoding::kGlobal,
+                            ladder::NeighborEncoding::kLocal}) {
+        if (!ladder::Csr::sort_lists(csr_prefix, encoding)) {
+          LOG(ERROR) << "failed to sort " << csr_prefix;
+          return 1;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
@@ -1,11 +1,14 @@
 #include <mpi.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <chrono>
 #include <fstream>
 
 #include "graph/graph_db.h"
 #include "ladder/app.h"
+#include "ladder/topology.h"
 #include "ladder/worker.h"
 #include "nlohmann_json/json.hpp"
 
@@ -48,37 +51,114 @@ parse_query_config(const std::string& path) {
   return ret;
 }
 
+// Number of processes the MPI launcher started, as reported in the environment
+// of each of them by Open MPI and by PMI-based launchers such as MPICH's and
+// Slurm's. 1 when started without a launcher.
+int launcher_process_num() {
+  for (const char* name : {"OMPI_COMM_WORLD_SIZE", "PMI_SIZE"}) {
+    const char* value = getenv(name);
+    if (value != nullptr) {
+      return atoi(value);
+    }
+  }
+  return 1;
+}
+
 int main(int argc, char** argv) {
   std::string prefix = argv[1];
   std::string lib_prefix = argv[2];
   std::string query_config = argv[3];
 
-  int rank, size;
-  int provided;
-  MPI_Init_thread(NULL, NULL, MPI_THREAD_MULTIPLE, &provided);
+  ladder::StorageStrategy strategy = ladder::StorageStrategy::kMemory;
+  int load_thread_num = std::thread::hardware_concurrency();
+  int split_threshold = ladder::DEFAULT_SPLIT_THRESHOLD;
+  int worker_num = std::thread::hardware_concurrency();
+  ladder::PinPolicy pin_policy = ladder::PinPolicy::kNone;
+  bool numa_interleave = false;
+  bool streaming = false;
+  bool single_server = false;
+  for (int i = 4; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--mmap") {
+      strategy = ladder::StorageStrategy::kMmap;
+    } else if (arg.rfind("--load_threads=", 0) == 0) {
+      load_thread_num = std::stoi(arg.substr(strlen("--load_threads=")));
+    } else if (arg.rfind("--split_threshold=", 0) == 0) {
+      split_threshold = std::stoi(arg.substr(strlen("--split_threshold=")));
+    } else if (arg.rfind("--workers=", 0) == 0) {
+      worker_num = std::stoi(arg.substr(strlen("--workers=")));
+    } else if (arg == "--pin=compact") {
+      pin_policy = ladder::PinPolicy::kCompact;
+    } else if (arg == "--pin=scatter") {
+      pin_policy = ladder::PinPolicy::kScatter;
+    } else if (arg == "--numa_interleave") {
+      numa_interleave = true;
+    } else if (arg == "--streaming") {
+      streaming = true;
+    } else if (arg == "--single_server") {
+      single_server = true;
+    } else {
+      std::cerr << "Unknown option: " << arg << std::endl;
+    }
+  }
 
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  // A single server runs without MPI, see Communicator. Every process of a
+  // multi-process launch would then load partition 0 of 1 and answer alone.
+  if (single_server && launcher_process_num() > 1) {
+    std::cerr << "--single_server runs one process, but the launcher started "
+              << launcher_process_num() << std::endl;
+    return 1;
+  }
+  int rank = 0, size = 1;
+  if (!single_server) {
+    int provided;
+    MPI_Init_thread(NULL, NULL, MPI_THREAD_MULTIPLE, &provided);
 
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+  }
+
+  // Graph arrays are read by workers on every node, so they are spread over
+  // all nodes. Worker buffers are allocated later, under the default local
+  // policy.
+  ladder::Topology topology;
+  if (numa_interleave &&
+      !ladder::set_interleave_policy(topology.node_mask())) {
+    std::cerr << "Failed to interleave graph memory" << std::endl;
+  }
   ladder::GraphDB graph;
-  graph.open(prefix, rank, size);
+  // The queries read global neighbor ids, so partition-local lists written by
+  // encode_neighbors are only opened through GraphDB::open by code whose views
+  // use NeighborEncoding::kLocal.
+  graph.open(prefix, rank, size, strategy, load_thread_num);
+  if (numa_interleave) {
+    ladder::reset_memory_policy();
+  }
 
   {
-    int worker_num = std::thread::hardware_concurrency();
-    int reduced_worker_num = 0;
-    MPI_Allreduce(&worker_num, &reduced_worker_num, 1, MPI_INT, MPI_MIN,
-                  MPI_COMM_WORLD);
+    int reduced_worker_num = worker_num;
+    if (!single_server) {
+      MPI_Allreduce(&worker_num, &reduced_worker_num, 1, MPI_INT, MPI_MIN,
+                    MPI_COMM_WORLD);
+    }
     ladder::Worker worker(reduced_worker_num, rank, size);
+    worker.set_split_threshold(split_threshold);
+    worker.set_pin_policy(pin_policy);
+    worker.set_streaming(streaming);
     auto queries = parse_query_config(query_config);
     for (auto& pair : queries) {
       std::string lib_path =
           lib_prefix + "/libbi" + std::to_string(pair.first) + ".so";
       ladder::App app(lib_path);
 
-      MPI_Barrier(MPI_COMM_WORLD);
+      if (!single_server) {
+        MPI_Barrier(MPI_COMM_WORLD);
+      }
       auto start = std::chrono::high_resolution_clock::now();
       worker.EvalBatch(graph, app, pair.second);
-      MPI_Barrier(MPI_COMM_WORLD);
+      if (!single_server) {
+        MPI_Barrier(MPI_COMM_WORLD);
+      }
       auto end = std::chrono::high_resolution_clock::now();
       auto duration =
           std::chrono::duration_cast<std::chrono::microseconds>(end - start);
@@ -91,7 +171,9 @@ int main(int argc, char** argv) {
     }
   }
 
-  MPI_Finalize();
+  if (!single_server) {
+    MPI_Finalize();
+  }
 
   return 0;
 }
\ No newline at end of file
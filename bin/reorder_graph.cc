@@ -0,0 +1,519 @@
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "graph/csr.h"
+#include "graph/schema.h"
+#include "graph/vertex_map.h"
+#include "property/types.h"
+#include "utils.h"
+
+namespace {
+
+// order[new_id] = old_id.
+using Order = std::vector<size_t>;
+
+constexpr size_t NO_ROW = std::numeric_limits<size_t>::max();
+constexpr ladder::gid_t EMPTY_SLOT = std::numeric_limits<ladder::gid_t>::max();
+
+std::string partition_prefix(const std::string& prefix, int partition_id) {
+  return prefix + "/graph_data_bin/partition_" + std::to_string(partition_id);
+}
+
+// new[i] = old[order[i]], or fill if order[i] is past the end of old.
+template <typename T>
+bool permute_file(const std::string& fname, const Order& order, T fill = T()) {
+  std::vector<T> old_values;
+  ladder::load_from_file(fname, old_values);
+  std::vector<T> values(order.size(), fill);
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (order[i] < old_values.size()) {
+      values[i] = old_values[order[i]];
+    }
+  }
+  return ladder::dump_to_file(fname, values.data(), values.size());
+}
+
+// Files derived from row ids, which are rebuilt by build_indices and
+// encode_columns.
+void remove_derived_files(const std::string& prefix) {
+  for (const char* suffix :
+       {"_meta", "_packed", "_run_values", "_run_ends", "_dict", "_zone_min",
+        "_zone_max", "_sorted", "_pindex", "_pindex_offsets", "_pindex_rows",
+        "_pindex_meta", "_noffset", "_noffset_meta"}) {
+    std::remove((prefix + suffix).c_str());
+  }
+}
+
+// Compact offsets and encoded neighbor lists build_indices wrote next to the
+// plain files. They are rebuilt by build_indices.
+void remove_layout_files(const std::string& csr_prefix) {
+  for (const char* suffix : {"_compact_offsets", "_compact_bases",
+                             "_compact_wide", "_compact_meta"}) {
+    std::remove((csr_prefix + suffix).c_str());
+  }
+  for (const char* nbrs_suffix : {"_nbrs", "_lnbrs"}) {
+    for (const char* suffix :
+         {"_compressed", "_compressed_offsets", "_compressed_meta"}) {
+      std::remove((csr_prefix + nbrs_suffix + suffix).c_str());
+    }
+  }
+}
+
+bool permute_string_column(const std::string& prefix, const Order& order) {
+  std::vector<size_t> old_offsets;
+  std::vector<uint16_t> old_lengths;
+  std::vector<char> old_content;
+  ladder::load_from_file(prefix + "_offset", old_offsets);
+  ladder::load_from_file(prefix + "_length", old_lengths);
+  ladder::load_from_file(prefix + "_content", old_content);
+  std::vector<size_t> offsets(order.size(), 0);
+  std::vector<uint16_t> lengths(order.size(), 0);
+  std::vector<char> content;
+  content.reserve(old_content.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    offsets[i] = content.size();
+    if (order[i] < old_offsets.size()) {
+      auto begin = old_content.begin() + old_offsets[order[i]];
+      lengths[i] = old_lengths[order[i]];
+      content.insert(content.end(), begin, begin + lengths[i]);
+    }
+  }
+  return ladder::dump_to_file(prefix + "_offset", offsets.data(),
+                              offsets.size()) &&
+         ladder::dump_to_file(prefix + "_length", lengths.data(),
+                              lengths.size()) &&
+         ladder::dump_to_file(prefix + "_content", content.data(),
+                              content.size());
+}
+
+bool permute_column(const std::string& prefix, ladder::DataType type,
+                    const Order& order) {
+  remove_derived_files(prefix);
+  switch (type) {
+  case ladder::DataType::kInt32:
+  case ladder::DataType::kUInt32:
+  case ladder::DataType::kFloat:
+  case ladder::DataType::kDate:
+    return permute_file<uint32_t>(prefix, order);
+  case ladder::DataType::kInt64:
+  case ladder::DataType::kUInt64:
+  case ladder::DataType::kDouble:
+  case ladder::DataType::kDateTime:
+  case ladder::DataType::kID:
+    return permute_file<uint64_t>(prefix, order);
+  case ladder::DataType::kString:
+    return permute_string_column(prefix, order);
+  case ladder::DataType::kLCString:
+    // Codes move with their rows, the code table stays as is.
+    return permute_file<uint16_t>(prefix + "_index", order);
+  default:
+    return true;
+  }
+}
+
+bool permute_table(
+    const std::string& table_prefix,
+    const std::vector<std::pair<std::string, ladder::DataType>>& header,
+    const Order& order) {
+  for (size_t col_i = 0; col_i < header.size(); ++col_i) {
+    std::string col_prefix = table_prefix + "_col_" + std::to_string(col_i);
+    if (!permute_column(col_prefix, header[col_i].second, order)) {
+      LOG(ERROR) << "failed to reorder " << col_prefix;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Adjacency files of one direction of an edge triplet, in the default
+// layout. A single csr stores one slot per vertex, EMPTY_SLOT if none.
+struct CsrFiles {
+  void load(const std::string& csr_prefix, bool is_single) {
+    prefix = csr_prefix;
+    single = is_single;
+    ladder::load_from_file(prefix + "_nbrs", nbrs);
+    ladder::load_from_file(prefix + "_meta", meta);
+    if (!single) {
+      ladder::load_from_file(prefix + "_offsets", offsets);
+      ladder::load_from_file(prefix + "_degree", degree);
+    }
+  }
+
+  size_t rows() const { return single ? nbrs.size() : offsets.size(); }
+
+  int get_degree(size_t v) const {
+    if (v >= rows()) {
+      return 0;
+    }
+    return single ? (nbrs[v] != EMPTY_SLOT) : degree[v];
+  }
+
+  // Position of the first edge of v in the neighbor and edge property files.
+  size_t edge_offset(size_t v) const { return single ? v : offsets[v]; }
+
+  // Lays out the rows in order, and returns the old edge positions in their
+  // new order, to permute edge properties and local neighbor lists with.
+  Order reorder(const Order& order) {
+    Order edge_order;
+    std::vector<ladder::gid_t> new_nbrs;
+    if (single) {
+      edge_order = order;
+      new_nbrs.resize(order.size(), EMPTY_SLOT);
+      for (size_t i = 0; i < order.size(); ++i) {
+        if (order[i] < nbrs.size()) {
+          new_nbrs[i] = nbrs[order[i]];
+        }
+      }
+      meta[0] = order.size();
+    } else {
+      std::vector<size_t> new_offsets(order.size());
+      std::vector<int> new_degree(order.size());
+      for (size_t i = 0; i < order.size(); ++i) {
+        new_offsets[i] = new_nbrs.size();
+        new_degree[i] = get_degree(order[i]);
+        for (int k = 0; k < new_degree[i]; ++k) {
+          edge_order.push_back(offsets[order[i]] + k);
+          new_nbrs.push_back(nbrs[offsets[order[i]] + k]);
+        }
+      }
+      offsets.swap(new_offsets);
+      degree.swap(new_degree);
+    }
+    nbrs.swap(new_nbrs);
+    return edge_order;
+  }
+
+  bool dump() const {
+    remove_layout_files(prefix);
+    bool ok =
+        ladder::dump_to_file(prefix + "_nbrs", nbrs.data(), nbrs.size()) &&
+        ladder::dump_to_file(prefix + "_meta", meta.data(), meta.size());
+    if (ok && !single) {
+      ok = ladder::dump_to_file(prefix + "_offsets", offsets.data(),
+                                offsets.size()) &&
+           ladder::dump_to_file(prefix + "_degree", degree.data(),
+                                degree.size());
+    }
+    return ok;
+  }
+
+  std::string prefix;
+  bool single;
+  std::vector<ladder::gid_t> nbrs;
+  std::vector<size_t> offsets;
+  std::vector<int> degree;
+  std::vector<size_t> meta;
+};
+
+// A csr file together with the labels of its rows and of its neighbors, and
+// the edge property table sharing its edge positions.
+struct CsrEntry {
+  ladder::label_t row_label;
+  std::string prop_prefix;
+  const std::vector<std::pair<std::string, ladder::DataType>>* header;
+  CsrFiles files;
+};
+
+class PartitionReorderer {
+ public:
+  PartitionReorderer(const ladder::Schema& schema, const std::string& prefix,
+                     int partition_id)
+      : schema_(schema),
+        prefix_(partition_prefix(prefix, partition_id)),
+        label_num_(schema.vertex_label_num()) {}
+
+  void load() {
+    vertex_map_.open(prefix_ + "/vm", label_num_,
+                     ladder::StorageStrategy::kMemory);
+    for (ladder::label_t src = 0; src < label_num_; ++src) {
+      for (ladder::label_t edge = 0; edge < schema_.edge_label_num();
+           ++edge) {
+        for (ladder::label_t dst = 0; dst < label_num_; ++dst) {
+          if (!schema_.exist_edge_triplet(src, edge, dst)) {
+            continue;
+          }
+          std::string suffix = std::to_string(src) + "_" +
+                               std::to_string(edge) + "_" +
+                               std::to_string(dst);
+          const auto* header = &schema_.get_edge_header(src, edge, dst);
+          csrs_.push_back({src, prefix_ + "/oep_" + suffix, header, {}});
+          csrs_.back().files.load(prefix_ + "/oe_" + suffix,
+                                  schema_.oe_is_single(src, edge, dst));
+          csrs_.push_back({dst, prefix_ + "/iep_" + suffix, header, {}});
+          csrs_.back().files.load(prefix_ + "/ie_" + suffix,
+                                  schema_.ie_is_single(src, edge, dst));
+        }
+      }
+    }
+    degree_.resize(label_num_);
+    for (ladder::label_t label = 0; label < label_num_; ++label) {
+      degree_[label].resize(vertex_map_.get_vertices_num(label), 0);
+    }
+    for (auto& csr : csrs_) {
+      auto& degree = degree_[csr.row_label];
+      for (size_t v = 0; v < degree.size(); ++v) {
+        degree[v] += csr.files.get_degree(v);
+      }
+    }
+  }
+
+  // Hubs first, ties kept in key order.
+  void order_by_degree() {
+    orders_.resize(label_num_);
+    for (ladder::label_t label = 0; label < label_num_; ++label) {
+      orders_[label] = by_degree(label);
+    }
+  }
+
+  // Breadth-first over the edges within the partition, across labels, so
+  // that vertices expanded together get nearby ids. Roots are taken by
+  // descending degree.
+  void order_by_bfs() {
+    std::vector<std::vector<size_t>> ranks(label_num_);
+    std::vector<std::pair<ladder::label_t, size_t>> roots;
+    for (ladder::label_t label = 0; label < label_num_; ++label) {
+      ranks[label].resize(degree_[label].size(), NO_ROW);
+      for (size_t v : by_degree(label)) {
+        roots.emplace_back(label, v);
+      }
+    }
+    std::stable_sort(roots.begin(), roots.end(),
+                     [this](const std::pair<ladder::label_t, size_t>& a,
+                            const std::pair<ladder::label_t, size_t>& b) {
+                       return degree_[a.first][a.second] >
+                              degree_[b.first][b.second];
+                     });
+
+    orders_.assign(label_num_, Order());
+    auto visit = [&](ladder::label_t label, size_t v,
+                     std::deque<std::pair<ladder::label_t, size_t>>& queue) {
+      if (ranks[label][v] == NO_ROW) {
+        ranks[label][v] = orders_[label].size();
+        orders_[label].push_back(v);
+        queue.emplace_back(label, v);
+      }
+    };
+    std::deque<std::pair<ladder::label_t, size_t>> queue;
+    for (auto& root : roots) {
+      visit(root.first, root.second, queue);
+      while (!queue.empty()) {
+        auto [label, v] = queue.front();
+        queue.pop_front();
+        for (auto& csr : csrs_) {
+          if (csr.row_label != label) {
+            continue;
+          }
+          const CsrFiles& files = csr.files;
+          int deg = files.get_degree(v);
+          for (int k = 0; k < deg; ++k) {
+            ladder::gid_t nbr = files.nbrs[files.edge_offset(v) + k];
+            ladder::vertex_t u;
+            if (vertex_map_.get_internal_id(nbr, u)) {
+              visit(vertex_map_.get_label_id(nbr), u, queue);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Mean id distance between the endpoints of edges within the partition,
+  // before and after reordering.
+  void log_locality() const {
+    double before = 0, after = 0;
+    size_t edge_num = 0;
+    std::vector<std::vector<size_t>> ranks = get_ranks();
+    for (auto& csr : csrs_) {
+      const CsrFiles& files = csr.files;
+      for (size_t v = 0; v < files.rows(); ++v) {
+        int deg = files.get_degree(v);
+        for (int k = 0; k < deg; ++k) {
+          ladder::gid_t nbr = files.nbrs[files.edge_offset(v) + k];
+          ladder::vertex_t u;
+          if (vertex_map_.get_label_id(nbr) == csr.row_label &&
+              vertex_map_.get_internal_id(nbr, u)) {
+            const auto& rank = ranks[csr.row_label];
+            before += u > v ? u - v : v - u;
+            after += rank[u] > rank[v] ? rank[u] - rank[v] : rank[v] - rank[u];
+            ++edge_num;
+          }
+        }
+      }
+    }
+    if (edge_num != 0) {
+      LOG(INFO) << prefix_ << ": mean id gap of " << edge_num
+                << " local edges " << before / edge_num << " -> "
+                << after / edge_num;
+    }
+  }
+
+  // Rewrites the vertex map, vertex and edge properties and csrs of the
+  // partition in the new order.
+  bool apply() {
+    for (ladder::label_t label = 0; label < label_num_; ++label) {
+      std::string vm_prefix = prefix_ + "/vm_" + std::to_string(label);
+      if (!permute_file<ladder::gid_t>(vm_prefix + "_keys",
+                                       orders_[label])) {
+        return false;
+      }
+      std::remove((vm_prefix + "_indices").c_str());
+      std::remove((vm_prefix + "_indices_meta").c_str());
+      if (!permute_table(prefix_ + "/vp_" + std::to_string(label),
+                         schema_.get_vertex_header(label), orders_[label])) {
+        return false;
+      }
+    }
+    for (auto& csr : csrs_) {
+      if (csr.files.rows() > orders_[csr.row_label].size()) {
+        LOG(ERROR) << csr.files.prefix << " has more rows than vertices";
+        return false;
+      }
+      Order edge_order = csr.files.reorder(orders_[csr.row_label]);
+      if (!csr.files.dump() ||
+          !permute_table(csr.prop_prefix, *csr.header, edge_order)) {
+        return false;
+      }
+      std::string lnbrs_fname = csr.files.prefix + "_lnbrs";
+      if (ladder::file_exists(lnbrs_fname) &&
+          !permute_file<ladder::gid_t>(lnbrs_fname, edge_order,
+                                       EMPTY_SLOT)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // ranks[label][old_id] = new_id.
+  std::vector<std::vector<size_t>> get_ranks() const {
+    std::vector<std::vector<size_t>> ranks(label_num_);
+    for (ladder::label_t label = 0; label < label_num_; ++label) {
+      ranks[label].resize(orders_[label].size());
+      for (size_t i = 0; i < orders_[label].size(); ++i) {
+        ranks[label][orders_[label][i]] = i;
+      }
+    }
+    return ranks;
+  }
+
+  std::vector<std::string> csr_prefixes() const {
+    std::vector<std::string> prefixes;
+    for (auto& csr : csrs_) {
+      prefixes.push_back(csr.files.prefix);
+    }
+    return prefixes;
+  }
+
+ private:
+  Order by_degree(ladder::label_t label) const {
+    const auto& degree = degree_[label];
+    Order order(degree.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&degree](size_t a, size_t b) {
+      return degree[a] > degree[b];
+    });
+    return order;
+  }
+
+  const ladder::Schema& schema_;
+  std::string prefix_;
+  ladder::label_t label_num_;
+  ladder::VertexMap vertex_map_;
+  std::vector<CsrEntry> csrs_;
+  std::vector<std::vector<size_t>> degree_;
+  std::vector<Order> orders_;
+};
+
+// Partition-local neighbor ids embed the owner's internal ids, which have
+// all changed, see bin/encode_neighbors.cc.
+bool remap_local_neighbors(
+    const std::string& lnbrs_fname,
+    const std::vector<std::vector<std::vector<size_t>>>& ranks) {
+  std::vector<ladder::gid_t> lnbrs;
+  ladder::load_from_file(lnbrs_fname, lnbrs);
+  for (auto& local_id : lnbrs) {
+    if (local_id == EMPTY_SLOT) {
+      continue;
+    }
+    int owner = ladder::VertexMap::get_local_owner(local_id);
+    const auto& rank =
+        ranks[owner][ladder::VertexMap::get_label_id(local_id)];
+    local_id = (local_id & ~ladder::VertexMap::LOCAL_VID_MASK) |
+               rank[ladder::VertexMap::get_local_vertex(local_id)];
+  }
+  return ladder::dump_to_file(lnbrs_fname, lnbrs.data(), lnbrs.size());
+}
+
+}  // namespace
+
+// Relabels the internal vertex ids of every partition for locality, either
+// by descending degree or in breadth-first order, and rewrites the vertex
+// maps, vertex and edge properties and csrs (default layout) in place.
+// Global ids are unchanged, so partitioning and queries are not affected.
+// Hash indices, property indices, zone maps and column encodings refer to
+// row ids and are removed; build_indices and encode_columns recreate them.
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <prefix> <partition_num> [degree|bfs]" << std::endl;
+    return 1;
+  }
+  std::string prefix = argv[1];
+  int partition_num = atoi(argv[2]);
+  std::string method = argc > 3 ? argv[3] : "degree";
+  if (method != "degree" && method != "bfs") {
+    std::cerr << "Unknown order " << method << std::endl;
+    return 1;
+  }
+
+  ladder::Schema schema;
+  schema.open(prefix + "/graph_schema/schema.json");
+
+  std::vector<std::vector<std::vector<size_t>>> ranks(partition_num);
+  std::vector<std::string> csr_prefixes;
+  for (int partition_id = 0; partition_id < partition_num; ++partition_id) {
+    PartitionReorderer reorderer(schema, prefix, partition_id);
+    reorderer.load();
+    if (method == "bfs") {
+      reorderer.order_by_bfs();
+    } else {
+      reorderer.order_by_degree();
+    }
+    reorderer.log_locality();
+    if (!reorderer.apply()) {
+      LOG(ERROR) << "failed to reorder partition " << partition_id;
+      return 1;
+    }
+    ranks[partition_id] = reorderer.get_ranks();
+    for (auto& csr_prefix : reorderer.csr_prefixes()) {
+      csr_prefixes.push_back(csr_prefix);
+    }
+    LOG(INFO) << "reordered partition " << partition_id;
+  }
+
+  for (auto& csr_prefix : csr_prefixes) {
+    std::string lnbrs_fname = csr_prefix + "_lnbrs";
+    if (ladder::file_exists(lnbrs_fname) &&
+        !remap_local_neighbors(lnbrs_fname, ranks)) {
+      LOG(ERROR) << "failed to remap " << lnbrs_fname;
+      return 1;
+    }
+    // Remapped ids are out of order in lists that were sorted.
+    auto local = ladder::NeighborEncoding::kLocal;
+    std::vector<size_t> meta;
+    ladder::load_from_file(csr_prefix + "_meta", meta);
+    if (ladder::file_exists(lnbrs_fname) &&
+        ladder::lists_are_sorted(meta, local) &&
+        !ladder::Csr::sort_lists(csr_prefix, local)) {
+      LOG(ERROR) << "failed to sort " << lnbrs_fname;
+      return 1;
+    }
+  }
+
+  return 0;
+}
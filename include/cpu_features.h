@@ -0,0 +1,27 @@
+#ifndef LADDER_CPU_FEATURES_H_
+#define LADDER_CPU_FEATURES_H_
+
+// SIMD kernels are compiled for their instruction set with LADDER_TARGET_AVX2
+// whatever the build flags, and only called when cpu_has_avx2() holds, so
+// that one binary runs on every machine of a cluster.
+#if defined(__x86_64__) || defined(__i386__)
+#define LADDER_HAS_X86_KERNELS 1
+#define LADDER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace ladder {
+
+inline bool cpu_has_avx2() {
+#if defined(__AVX2__)
+  return true;
+#elif defined(LADDER_HAS_X86_KERNELS)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+#else
+  return false;
+#endif
+}
+
+}  // namespace ladder
+
+#endif  // LADDER_CPU_FEATURES_H_
@@ -0,0 +1,301 @@
+#ifndef LADDER_GRAPH_COMPACT_CSR_H
+#define LADDER_GRAPH_COMPACT_CSR_H
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "graph/i_csr.h"
+#include "graph/types.h"
+#include "mmap_array.h"
+#include "utils.h"
+
+namespace ladder {
+
+// Csr without a degree array: degrees are derived from n + 1 offsets. Offsets
+// are stored as 32-bit values relative to a 64-bit base per block of
+// vertices. A block spanning more than 4G edges keeps 64-bit offsets of its
+// own instead, so one such block does not widen the whole csr.
+//
+// build_indices writes the layout next to the plain files as
+// "<prefix>_compact_offsets", "_compact_bases", "_compact_wide" and
+// "_compact_meta", see dump, after repacking non-contiguous neighbor files so
+// that list u ends where list u + 1 starts. open() maps it, and only builds
+// the layout in memory when the files are missing or older than the offsets.
+class CompactCsr final : public ICsr {
+  static constexpr size_t BLOCK_SHIFT = 12;
+  static constexpr size_t BLOCK_MASK = (size_t(1) << BLOCK_SHIFT) - 1;
+  // Set in the base of a block with 64-bit offsets, whose remaining bits are
+  // the position of its first offset in wide_offsets_.
+  static constexpr size_t WIDE_BLOCK = size_t(1) << 63;
+  // Bumped whenever the layout changes.
+  static constexpr size_t FORMAT_VERSION = 1;
+
+ public:
+  CompactCsr() : sorted_(false) {}
+  ~CompactCsr() = default;
+
+  void open(const std::string& prefix, StorageStrategy strategy,
+            NeighborEncoding encoding) override {
+    encoding_ = encoding;
+    std::string nbr_list_fname = neighbor_list_fname(prefix, encoding);
+    neighbors_.open(nbr_list_fname, strategy);
+
+    std::string meta_fname = prefix + "_meta";
+    std::vector<size_t> meta;
+    load_from_file(meta_fname, meta);
+    edge_num_ = meta[0];
+    sorted_ = lists_are_sorted(meta, encoding);
+    vertex_num_ = get_file_size(prefix + "_offsets") / sizeof(size_t);
+
+    if (!load_layout(prefix, strategy)) {
+      LOG(WARNING) << "building the compact layout of " << prefix
+                   << " in memory, run build_indices to persist it";
+      build(prefix);
+    }
+  }
+
+  // Repacks the neighbor files of the csr at prefix if their lists are not
+  // contiguous, then writes the compact layout next to them. Files are
+  // replaced by rename, see replace_file.
+  static bool dump(const std::string& prefix) {
+    std::vector<size_t> offsets;
+    std::vector<int> degree;
+    load_from_file(prefix + "_offsets", offsets);
+    load_from_file(prefix + "_degree", degree);
+    std::vector<size_t> full_offsets(offsets.size() + 1);
+    for (size_t u = 0; u < offsets.size(); ++u) {
+      full_offsets[u + 1] = full_offsets[u] + degree[u];
+    }
+    if (!std::equal(offsets.begin(), offsets.end(), full_offsets.begin())) {
+      for (auto encoding :
+           {NeighborEncoding::kGlobal, NeighborEncoding::kLocal}) {
+        std::string fname = neighbor_list_fname(prefix, encoding);
+        if (file_exists(fname) &&
+            !repack(fname, offsets, degree, full_offsets.back())) {
+          return false;
+        }
+      }
+      if (!replace_file(prefix + "_offsets", full_offsets.data(),
+                        offsets.size())) {
+        return false;
+      }
+    }
+
+    CompactCsr csr;
+    std::vector<size_t> meta;
+    load_from_file(prefix + "_meta", meta);
+    csr.edge_num_ = meta[0];
+    csr.vertex_num_ = offsets.size();
+    csr.build_layout(full_offsets);
+
+    // The meta goes last, so that an open in between builds in memory.
+    std::string layout_prefix = prefix + "_compact";
+    std::remove((layout_prefix + "_meta").c_str());
+    std::vector<size_t> layout_meta = csr.make_meta(prefix);
+    return replace_file(layout_prefix + "_offsets",
+                        csr.narrow_offsets_.data(),
+                        csr.narrow_offsets_.size()) &&
+           replace_file(layout_prefix + "_bases", csr.block_base_.data(),
+                        csr.block_base_.size()) &&
+           replace_file(layout_prefix + "_wide", csr.wide_offsets_.data(),
+                        csr.wide_offsets_.size()) &&
+           replace_file(layout_prefix + "_meta", layout_meta.data(),
+                        layout_meta.size());
+  }
+
+  inline size_t vertex_num() const override { return vertex_num_; }
+
+  inline size_t edge_num() const override { return edge_num_; }
+
+  inline int degree(vertex_t u) const override {
+    if (u >= vertex_num_) {
+      return 0;
+    }
+    return offset(u + 1) - offset(u);
+  }
+
+  inline AdjList get_edges(vertex_t u) const override {
+    if (u >= vertex_num_) {
+      return AdjList::empty();
+    }
+    size_t begin = offset(u);
+    int deg = offset(u + 1) - begin;
+    return deg == 0 ? AdjList::empty() : AdjList(&neighbors_[begin], deg);
+  }
+
+  inline AdjList get_partial_edges(vertex_t u, int part_i,
+                                   int part_num) const override {
+    if (u >= vertex_num_) {
+      return AdjList::empty();
+    }
+    size_t begin = offset(u);
+    int deg = offset(u + 1) - begin;
+    int part_size = (deg + part_num - 1) / part_num;
+    int start = std::min(part_i * part_size, deg);
+    int end = std::min(start + part_size, deg);
+    return start == end ? AdjList::empty()
+                        : AdjList(&neighbors_[begin + start], end - start);
+  }
+
+  inline AdjOffsetList get_edges_with_offset(vertex_t u) const override {
+    if (u >= vertex_num_) {
+      return AdjOffsetList::empty();
+    }
+    size_t begin = offset(u);
+    int deg = offset(u + 1) - begin;
+    return deg == 0 ? AdjOffsetList::empty()
+                    : AdjOffsetList(&neighbors_[begin], deg, begin);
+  }
+
+  inline void prefetch_vertex(vertex_t u) const {
+    if (u >= vertex_num_) {
+      return;
+    }
+    __builtin_prefetch(&block_base_[u >> BLOCK_SHIFT]);
+    __builtin_prefetch(&narrow_offsets_[u]);
+  }
+
+  inline void prefetch_edges(vertex_t u) const {
+    if (u < vertex_num_) {
+      __builtin_prefetch(neighbors_.data() + offset(u));
+    }
+  }
+
+  void sort_neighbors() override {
+    std::vector<gid_t> neighbors(neighbors_.begin(), neighbors_.end());
+    for (vertex_t u = 0; u < vertex_num_; ++u) {
+      std::sort(neighbors.begin() + offset(u),
+                neighbors.begin() + offset(u + 1));
+    }
+    neighbors_.assign(std::move(neighbors));
+    sorted_ = true;
+  }
+
+  bool is_sorted() const override { return sorted_; }
+
+  size_t memory_usage() const override {
+    return neighbors_.size() * sizeof(gid_t) +
+           narrow_offsets_.size() * sizeof(uint32_t) +
+           block_base_.size() * sizeof(size_t) +
+           wide_offsets_.size() * sizeof(size_t);
+  }
+
+ private:
+  inline size_t offset(vertex_t u) const {
+    size_t base = block_base_[u >> BLOCK_SHIFT];
+    if (base & WIDE_BLOCK) {
+      return wide_offsets_[(base & ~WIDE_BLOCK) + (u & BLOCK_MASK)];
+    }
+    return base + narrow_offsets_[u];
+  }
+
+  // The layout is tied to the size and modification time of the offsets it
+  // was built from.
+  std::vector<size_t> make_meta(const std::string& prefix) const {
+    std::string offset_fname = prefix + "_offsets";
+    return {vertex_num_, edge_num_, FORMAT_VERSION,
+            get_file_size(offset_fname), get_file_mtime(offset_fname)};
+  }
+
+  bool load_layout(const std::string& prefix, StorageStrategy strategy) {
+    std::string layout_prefix = prefix + "_compact";
+    std::string meta_fname = layout_prefix + "_meta";
+    if (!file_exists(meta_fname)) {
+      return false;
+    }
+    std::vector<size_t> meta;
+    load_from_file(meta_fname, meta);
+    if (meta != make_meta(prefix)) {
+      LOG(WARNING) << "stale " << layout_prefix;
+      return false;
+    }
+    narrow_offsets_.open(layout_prefix + "_offsets", strategy);
+    block_base_.open(layout_prefix + "_bases", strategy);
+    wide_offsets_.open(layout_prefix + "_wide", strategy);
+    return narrow_offsets_.size() == vertex_num_ + 1 &&
+           block_base_.size() == (vertex_num_ >> BLOCK_SHIFT) + 1;
+  }
+
+  // Writes the lists of the neighbor file fname in vertex order.
+  static bool repack(const std::string& fname,
+                     const std::vector<size_t>& offsets,
+                     const std::vector<int>& degree, size_t edge_num) {
+    std::vector<gid_t> neighbors, packed;
+    load_from_file(fname, neighbors);
+    packed.reserve(edge_num);
+    for (size_t u = 0; u < offsets.size(); ++u) {
+      packed.insert(packed.end(), neighbors.begin() + offsets[u],
+                    neighbors.begin() + offsets[u] + degree[u]);
+    }
+    return replace_file(fname, packed.data(), packed.size());
+  }
+
+  // Builds the layout in memory, repacking the opened lists on the heap if
+  // they are not contiguous.
+  void build(const std::string& prefix) {
+    MmapArray<size_t> offsets;
+    offsets.open(prefix + "_offsets", StorageStrategy::kMmap);
+    MmapArray<int> degree;
+    degree.open(prefix + "_degree", StorageStrategy::kMmap);
+
+    std::vector<size_t> full_offsets(vertex_num_ + 1);
+    bool contiguous = true;
+    for (vertex_t u = 0; u < vertex_num_; ++u) {
+      full_offsets[u + 1] = full_offsets[u] + degree[u];
+      contiguous = contiguous && offsets[u] == full_offsets[u];
+    }
+    if (!contiguous) {
+      std::vector<gid_t> packed;
+      packed.reserve(full_offsets[vertex_num_]);
+      for (vertex_t u = 0; u < vertex_num_; ++u) {
+        packed.insert(packed.end(), neighbors_.begin() + offsets[u],
+                      neighbors_.begin() + offsets[u] + degree[u]);
+      }
+      neighbors_.assign(std::move(packed));
+    }
+    build_layout(full_offsets);
+  }
+
+  void build_layout(const std::vector<size_t>& full_offsets) {
+    size_t block_num = (vertex_num_ >> BLOCK_SHIFT) + 1;
+    std::vector<size_t> block_base(block_num);
+    std::vector<uint32_t> narrow_offsets(vertex_num_ + 1, 0);
+    std::vector<size_t> wide_offsets;
+    for (size_t b = 0; b < block_num; ++b) {
+      vertex_t begin = b << BLOCK_SHIFT;
+      vertex_t end = std::min<vertex_t>(begin + (1 << BLOCK_SHIFT),
+                                        vertex_num_ + 1);
+      if (full_offsets[end - 1] - full_offsets[begin] >
+          std::numeric_limits<uint32_t>::max()) {
+        block_base[b] = WIDE_BLOCK | wide_offsets.size();
+        wide_offsets.insert(wide_offsets.end(), full_offsets.begin() + begin,
+                            full_offsets.begin() + end);
+        continue;
+      }
+      block_base[b] = full_offsets[begin];
+      for (vertex_t u = begin; u < end; ++u) {
+        narrow_offsets[u] = full_offsets[u] - block_base[b];
+      }
+    }
+    narrow_offsets_.assign(std::move(narrow_offsets));
+    block_base_.assign(std::move(block_base));
+    wide_offsets_.assign(std::move(wide_offsets));
+  }
+
+  MmapArray<gid_t> neighbors_;
+  MmapArray<uint32_t> narrow_offsets_;
+  MmapArray<size_t> block_base_;
+  MmapArray<size_t> wide_offsets_;
+
+  size_t vertex_num_;
+  size_t edge_num_;
+  bool sorted_;
+};
+
+}  // namespace ladder
+
+#endif  // LADDER_GRAPH_COMPACT_CSR_H
@@ -0,0 +1,314 @@
+#ifndef LADDER_GRAPH_COMPRESSED_CSR_H
+#define LADDER_GRAPH_COMPRESSED_CSR_H
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "graph/i_csr.h"
+#include "graph/types.h"
+#include "mmap_array.h"
+#include "utils.h"
+
+namespace ladder {
+
+inline void encode_varint(uint64_t value, std::vector<uint8_t>& out) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+inline const uint8_t* decode_varint(const uint8_t* ptr, uint64_t& value) {
+  uint64_t byte = *ptr++;
+  value = byte & 0x7f;
+  int shift = 7;
+  while (byte & 0x80) {
+    byte = *ptr++;
+    value |= (byte & 0x7f) << shift;
+    shift += 7;
+  }
+  return ptr;
+}
+
+// Adjacency list of a CompressedCsr, decoded while iterating. Supports the
+// same range-for / get_neighbor() usage as AdjList.
+class CompressedAdjList {
+  class iterator {
+   public:
+    iterator(const uint8_t* ptr, int remaining, gid_t prev)
+        : ptr_(ptr), remaining_(remaining), cur_(prev) {
+      if (remaining_ > 0) {
+        decode_next();
+      }
+    }
+
+    inline gid_t get_neighbor() const { return cur_; }
+
+    inline iterator& operator++() {
+      if (--remaining_ > 0) {
+        decode_next();
+      }
+      return *this;
+    }
+
+    inline bool operator==(const iterator& rhs) const {
+      return remaining_ == rhs.remaining_;
+    }
+    inline bool operator!=(const iterator& rhs) const {
+      return remaining_ != rhs.remaining_;
+    }
+
+    inline const gid_t& operator*() const { return cur_; }
+
+   private:
+    inline void decode_next() {
+      uint64_t delta;
+      ptr_ = decode_varint(ptr_, delta);
+      cur_ += delta;
+    }
+
+    const uint8_t* ptr_;
+    int remaining_;
+    gid_t cur_;
+  };
+
+ public:
+  CompressedAdjList(const uint8_t* ptr, int deg, gid_t prev)
+      : ptr_(ptr), deg_(deg), prev_(prev) {}
+
+  iterator begin() const { return iterator(ptr_, deg_, prev_); }
+  iterator end() const { return iterator(nullptr, 0, 0); }
+
+  int size() const { return deg_; }
+
+  static CompressedAdjList empty() { return CompressedAdjList(nullptr, 0, 0); }
+
+ private:
+  const uint8_t* ptr_;
+  int deg_;
+  gid_t prev_;
+};
+
+// Csr whose adjacency lists are sorted and stored as varint-encoded deltas.
+// Each list is laid out as varint(degree) followed by varint(first neighbor)
+// and varint(neighbor[i] - neighbor[i - 1]).
+//
+// build_indices encodes the plain lists once and writes the stream next to
+// them as "<neighbor file>_compressed", with "_compressed_offsets" and
+// "_compressed_meta", see dump. open() maps it, and only encodes the lists in
+// memory when the files are missing or older than the plain lists.
+//
+// Lists are only read through the decoding CompressedAdjList, see
+// get_compressed_edges and CompressedGraphView. The ICsr accessors returning
+// AdjList would need a decoded copy that outlives the call, so GraphDB hands
+// compressed triplets out only as CompressedGraphView, and GraphView refuses
+// them.
+class CompressedCsr final : public ICsr {
+  // Bumped whenever the encoding changes.
+  static constexpr size_t FORMAT_VERSION = 1;
+
+ public:
+  CompressedCsr() = default;
+  ~CompressedCsr() = default;
+
+  void open(const std::string& prefix, StorageStrategy strategy,
+            NeighborEncoding encoding) override {
+    encoding_ = encoding;
+    std::string nbrs_fname = neighbor_list_fname(prefix, encoding);
+    load_csr_meta(prefix);
+
+    std::string compressed_prefix = nbrs_fname + "_compressed";
+    if (!load_compressed(compressed_prefix, nbrs_fname, strategy)) {
+      LOG(WARNING) << "encoding " << nbrs_fname
+                   << " in memory, run build_indices to persist it";
+      build(prefix, nbrs_fname);
+    }
+  }
+
+  // Encodes the lists of the csr at prefix and writes them next to the plain
+  // ones. The files are replaced by rename, so processes which mapped an
+  // older encoding keep reading it.
+  static bool dump(const std::string& prefix, NeighborEncoding encoding) {
+    CompressedCsr csr;
+    std::string nbrs_fname = neighbor_list_fname(prefix, encoding);
+    csr.load_csr_meta(prefix);
+    csr.build(prefix, nbrs_fname);
+
+    // The meta goes last, so that an open in between encodes in memory.
+    std::string compressed_prefix = nbrs_fname + "_compressed";
+    std::remove((compressed_prefix + "_meta").c_str());
+    std::vector<size_t> compressed_meta = csr.make_meta(nbrs_fname);
+    return replace_file(compressed_prefix, csr.bytes_.data(),
+                        csr.bytes_.size()) &&
+           replace_file(compressed_prefix + "_offsets",
+                        csr.byte_offsets_.data(), csr.byte_offsets_.size()) &&
+           replace_file(compressed_prefix + "_meta", compressed_meta.data(),
+                        compressed_meta.size());
+  }
+
+  inline size_t vertex_num() const override { return vertex_num_; }
+
+  inline size_t edge_num() const override { return edge_num_; }
+
+  inline int degree(vertex_t u) const override {
+    if (u >= vertex_num_) {
+      return 0;
+    }
+    uint64_t deg;
+    decode_varint(&bytes_[byte_offsets_[u]], deg);
+    return deg;
+  }
+
+  inline CompressedAdjList get_compressed_edges(vertex_t u) const {
+    if (u >= vertex_num_) {
+      return CompressedAdjList::empty();
+    }
+    uint64_t deg;
+    const uint8_t* ptr = decode_varint(&bytes_[byte_offsets_[u]], deg);
+    return CompressedAdjList(ptr, deg, 0);
+  }
+
+  inline CompressedAdjList get_compressed_partial_edges(vertex_t u,
+                                                        int part_i,
+                                                        int part_num) const {
+    if (u >= vertex_num_) {
+      return CompressedAdjList::empty();
+    }
+    uint64_t deg;
+    const uint8_t* ptr = decode_varint(&bytes_[byte_offsets_[u]], deg);
+    int part_size = (static_cast<int>(deg) + part_num - 1) / part_num;
+    int start = std::min<int>(part_i * part_size, deg);
+    int end = std::min<int>(start + part_size, deg);
+    gid_t prev = 0;
+    for (int i = 0; i < start; ++i) {
+      uint64_t delta;
+      ptr = decode_varint(ptr, delta);
+      prev += delta;
+    }
+    return CompressedAdjList(ptr, end - start, prev);
+  }
+
+  inline AdjList get_edges(vertex_t) const override {
+    LOG(FATAL) << "CompressedCsr::get_edges: use get_compressed_edges";
+    return AdjList::empty();
+  }
+
+  inline AdjList get_partial_edges(vertex_t, int, int) const override {
+    LOG(FATAL) << "CompressedCsr::get_partial_edges: use "
+                  "get_compressed_partial_edges";
+    return AdjList::empty();
+  }
+
+  // Compressed layouts are only used for triplets without edge properties.
+  inline AdjOffsetList get_edges_with_offset(vertex_t) const override {
+    LOG(FATAL) << "CompressedCsr has no edge offsets";
+    return AdjOffsetList::empty();
+  }
+
+  inline void prefetch_vertex(vertex_t u) const {
+    if (u < vertex_num_) {
+      __builtin_prefetch(&byte_offsets_[u]);
+    }
+  }
+
+  inline void prefetch_edges(vertex_t u) const {
+    if (u < vertex_num_) {
+      __builtin_prefetch(&bytes_[byte_offsets_[u]]);
+    }
+  }
+
+  // Lists are sorted when they are encoded.
+  void sort_neighbors() override {}
+
+  bool is_sorted() const override { return true; }
+
+  bool has_edge(vertex_t u, gid_t v) const override {
+    for (auto nbr : get_compressed_edges(u)) {
+      if (nbr >= v) {
+        return nbr == v;
+      }
+    }
+    return false;
+  }
+
+  size_t memory_usage() const override {
+    return bytes_.size() + byte_offsets_.size() * sizeof(size_t);
+  }
+
+ private:
+  void load_csr_meta(const std::string& prefix) {
+    std::vector<size_t> meta;
+    load_from_file(prefix + "_meta", meta);
+    edge_num_ = meta[0];
+    vertex_num_ = get_file_size(prefix + "_offsets") / sizeof(size_t);
+  }
+
+  // The stream is tied to the size and modification time of the plain lists
+  // it was encoded from.
+  std::vector<size_t> make_meta(const std::string& nbrs_fname) const {
+    return {vertex_num_, edge_num_, FORMAT_VERSION, get_file_size(nbrs_fname),
+            get_file_mtime(nbrs_fname)};
+  }
+
+  bool load_compressed(const std::string& compressed_prefix,
+                       const std::string& nbrs_fname,
+                       StorageStrategy strategy) {
+    std::string meta_fname = compressed_prefix + "_meta";
+    if (!file_exists(meta_fname)) {
+      return false;
+    }
+    std::vector<size_t> meta;
+    load_from_file(meta_fname, meta);
+    if (meta != make_meta(nbrs_fname)) {
+      LOG(WARNING) << "stale " << compressed_prefix;
+      return false;
+    }
+    bytes_.open(compressed_prefix, strategy);
+    byte_offsets_.open(compressed_prefix + "_offsets", strategy);
+    return byte_offsets_.size() == vertex_num_ + 1;
+  }
+
+  // The raw lists are only read once to build the encoded stream.
+  void build(const std::string& prefix, const std::string& nbrs_fname) {
+    MmapArray<gid_t> neighbors;
+    neighbors.open(nbrs_fname, StorageStrategy::kMmap);
+    MmapArray<size_t> offsets;
+    offsets.open(prefix + "_offsets", StorageStrategy::kMmap);
+    MmapArray<int> degree;
+    degree.open(prefix + "_degree", StorageStrategy::kMmap);
+
+    std::vector<uint8_t> bytes;
+    std::vector<size_t> byte_offsets(vertex_num_ + 1);
+    std::vector<gid_t> list;
+    for (vertex_t u = 0; u < vertex_num_; ++u) {
+      byte_offsets[u] = bytes.size();
+      list.assign(neighbors.begin() + offsets[u],
+                  neighbors.begin() + offsets[u] + degree[u]);
+      std::sort(list.begin(), list.end());
+      encode_varint(list.size(), bytes);
+      gid_t prev = 0;
+      for (auto v : list) {
+        encode_varint(v - prev, bytes);
+        prev = v;
+      }
+    }
+    byte_offsets[vertex_num_] = bytes.size();
+    bytes.shrink_to_fit();
+    bytes_.assign(std::move(bytes));
+    byte_offsets_.assign(std::move(byte_offsets));
+  }
+
+  MmapArray<uint8_t> bytes_;
+  MmapArray<size_t> byte_offsets_;
+
+  size_t vertex_num_;
+  size_t edge_num_;
+};
+
+}  // namespace ladder
+
+#endif  // LADDER_GRAPH_COMPRESSED_CSR_H
@@ -1,34 +1,62 @@
 #ifndef LADDER_GRAPH_CSR_H
 #define LADDER_GRAPH_CSR_H
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
 #include "graph/i_csr.h"
 #include "graph/types.h"
+#include "mmap_array.h"
 #include "utils.h"
 
 namespace ladder {
 
-class Csr : public ICsr {
+class Csr final : public ICsr {
  public:
-  Csr() = default;
+  Csr() : sorted_(false) {}
   ~Csr() = default;
 
-  void open(const std::string& prefix) override {
-    std::string nbr_list_fname = prefix + "_nbrs";
-    load_from_file(nbr_list_fname, neighbors_);
+  void open(const std::string& prefix, StorageStrategy strategy,
+            NeighborEncoding encoding) override {
+    encoding_ = encoding;
+    std::string nbr_list_fname = neighbor_list_fname(prefix, encoding);
+    neighbors_.open(nbr_list_fname, strategy);
 
     std::string offset_fname = prefix + "_offsets";
-    load_from_file(offset_fname, offsets_);
+    offsets_.open(offset_fname, strategy);
 
     std::string degree_fname = prefix + "_degree";
-    load_from_file(degree_fname, degree_);
+    degree_.open(degree_fname, strategy);
 
     std::string meta_fname = prefix + "_meta";
     std::vector<size_t> meta;
     load_from_file(meta_fname, meta);
     edge_num_ = meta[0];
+    sorted_ = lists_are_sorted(meta, encoding);
+  }
+
+  // Sorts every list of the neighbor file of encoding at prefix and records
+  // it in the meta, so that open() maps sorted lists as they are. The files
+  // are replaced by rename, see replace_file.
+  static bool sort_lists(const std::string& prefix,
+                         NeighborEncoding encoding) {
+    std::string nbr_list_fname = neighbor_list_fname(prefix, encoding);
+    std::vector<gid_t> neighbors;
+    std::vector<size_t> offsets, meta;
+    std::vector<int> degree;
+    load_from_file(nbr_list_fname, neighbors);
+    load_from_file(prefix + "_offsets", offsets);
+    load_from_file(prefix + "_degree", degree);
+    load_from_file(prefix + "_meta", meta);
+    for (size_t u = 0; u < offsets.size(); ++u) {
+      std::sort(neighbors.begin() + offsets[u],
+                neighbors.begin() + offsets[u] + degree[u]);
+    }
+    meta.resize(std::max<size_t>(meta.size(), 2), 0);
+    meta[1] |= sorted_lists_flag(encoding);
+    return replace_file(nbr_list_fname, neighbors.data(), neighbors.size()) &&
+           replace_file(prefix + "_meta", meta.data(), meta.size());
   }
 
   inline size_t vertex_num() const override { return offsets_.size(); }
@@ -65,12 +93,45 @@ class Csr : public ICsr {
                     : AdjOffsetList(&neighbors_[offsets_[u]], deg, offsets_[u]);
   }
 
+  // Prefetch hints for batched expansion, see TypedGraphView::expand. The
+  // neighbors of u can only be located once its offset has arrived.
+  inline void prefetch_vertex(vertex_t u) const {
+    if (u < degree_.size()) {
+      __builtin_prefetch(&offsets_[u]);
+      __builtin_prefetch(&degree_[u]);
+    }
+  }
+
+  inline void prefetch_edges(vertex_t u) const {
+    if (u < degree_.size() && degree_[u] != 0) {
+      __builtin_prefetch(&neighbors_[offsets_[u]]);
+    }
+  }
+
+  void sort_neighbors() override {
+    std::vector<gid_t> neighbors(neighbors_.begin(), neighbors_.end());
+    for (vertex_t u = 0; u < degree_.size(); ++u) {
+      std::sort(neighbors.begin() + offsets_[u],
+                neighbors.begin() + offsets_[u] + degree_[u]);
+    }
+    neighbors_.assign(std::move(neighbors));
+    sorted_ = true;
+  }
+
+  bool is_sorted() const override { return sorted_; }
+
+  size_t memory_usage() const override {
+    return neighbors_.size() * sizeof(gid_t) +
+           offsets_.size() * sizeof(size_t) + degree_.size() * sizeof(int);
+  }
+
  private:
-  std::vector<gid_t> neighbors_;
-  std::vector<size_t> offsets_;
-  std::vector<int> degree_;
+  MmapArray<gid_t> neighbors_;
+  MmapArray<size_t> offsets_;
+  MmapArray<int> degree_;
 
   size_t edge_num_;
+  bool sorted_;
 };
 
 }  // namespace ladder
@@ -1,10 +1,16 @@
 #ifndef LADDER_GRAPH_GRAPH_DB_H_
 #define LADDER_GRAPH_GRAPH_DB_H_
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include "glog/logging.h"
+#include "graph/compact_csr.h"
+#include "graph/compressed_csr.h"
 #include "graph/csr.h"
 #include "graph/graph_view.h"
 #include "graph/i_csr.h"
@@ -12,6 +18,7 @@
 #include "graph/scsr.h"
 #include "graph/vertex_map.h"
 #include "property/table.h"
+#include "thread_pool.h"
 
 namespace ladder {
 
@@ -36,29 +43,87 @@ class GraphDB {
     }
   }
 
-  void open(const std::string& prefix, int partition_id, int partition_num) {
+  void open(const std::string& prefix, int partition_id, int partition_num,
+            StorageStrategy strategy = StorageStrategy::kMemory,
+            int thread_num = std::thread::hardware_concurrency(),
+            NeighborEncoding encoding = NeighborEncoding::kGlobal) {
     partition_id_ = partition_id;
     partition_num_ = partition_num;
-    LOG(INFO) << "before open schema...";
+    neighbor_encoding_ = encoding;
 
     schema_.open(prefix + "/graph_schema/schema.json");
-    LOG(INFO) << "after open schema...";
     vertex_label_num_ = schema_.vertex_label_num();
     edge_label_num_ = schema_.edge_label_num();
 
     std::string partition_binary_prefix =
         prefix + "/graph_data_bin/partition_" + std::to_string(partition_id_);
 
-    vertex_map_.open(partition_binary_prefix + "/vm", vertex_label_num_);
-    LOG(INFO) << "after open vertex map...";
+    LoadPhase vertex_map_phase("vertex map");
+    LoadPhase vertex_prop_phase("vertex props");
+    LoadPhase csr_phase("csrs");
+    LoadPhase edge_prop_phase("edge props");
+
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool pool(thread_num);
+    auto submit = [&](LoadPhase& phase, std::function<void()>&& task) {
+      phase.task_num += 1;
+      pool.submit([&phase, &start, task = std::move(task)]() {
+        auto task_start = std::chrono::steady_clock::now();
+        task();
+        auto task_end = std::chrono::steady_clock::now();
+        phase.record(
+            std::chrono::duration_cast<std::chrono::microseconds>(task_end -
+                                                                  task_start)
+                .count(),
+            std::chrono::duration_cast<std::chrono::microseconds>(task_end -
+                                                                  start)
+                .count());
+      });
+    };
+
+    // Labels are opened concurrently, so a missing index of one label is
+    // built with its share of the load threads.
+    int index_thread_num =
+        std::max(1, thread_num / std::max<int>(1, vertex_label_num_));
+    vertex_map_.init(vertex_label_num_);
+    for (label_t i = 0; i < vertex_label_num_; ++i) {
+      submit(vertex_map_phase, [this, i, &partition_binary_prefix, strategy,
+                                index_thread_num]() {
+        vertex_map_.open_label(partition_binary_prefix + "/vm", i, strategy,
+                               index_thread_num);
+      });
+    }
+
     vertex_props_.resize(vertex_label_num_);
     for (label_t i = 0; i < vertex_label_num_; ++i) {
-      LOG(INFO) << "vertex prop - " << (int) i;
-      vertex_props_[i].open(
-          partition_binary_prefix + "/vp_" + std::to_string(i),
-          schema_.get_vertex_header(i));
+      auto& table = vertex_props_[i];
+      table.init(schema_.get_vertex_header(i));
+      std::string table_prefix =
+          partition_binary_prefix + "/vp_" + std::to_string(i);
+      for (size_t col_i = 0; col_i < table.col_num(); ++col_i) {
+        bool dictionary = schema_.vertex_prop_is_dictionary(i, col_i);
+        bool indexed = schema_.vertex_prop_is_indexed(i, col_i);
+        bool zone_map = schema_.vertex_prop_has_zone_map(i, col_i);
+        bool sorted_index = schema_.vertex_prop_has_sorted_index(i, col_i);
+        submit(vertex_prop_phase, [&table, table_prefix, col_i, strategy,
+                                   dictionary, indexed, zone_map,
+                                   sorted_index]() {
+          table.open_column(table_prefix, col_i, strategy);
+          if (dictionary) {
+            table.build_dictionary(col_i);
+          }
+          if (indexed) {
+            table.open_index(table_prefix, col_i, strategy);
+          }
+          if (zone_map) {
+            table.open_zone_map(table_prefix, col_i, strategy);
+          }
+          if (sorted_index) {
+            table.open_sorted_index(table_prefix, col_i, strategy);
+          }
+        });
+      }
     }
-    LOG(INFO) << "after open vertex props...";
 
     size_t csr_list_size = static_cast<size_t>(vertex_label_num_) *
                            static_cast<size_t>(edge_label_num_) *
@@ -71,46 +136,111 @@ class GraphDB {
         for (label_t dst_label = 0; dst_label < vertex_label_num_;
              ++dst_label) {
           if (schema_.exist_edge_triplet(src_label, edge_label, dst_label)) {
-            LOG(INFO) << "edge: src -" << (int) src_label << ", edge - "
-                      << (int) edge_label << ", dst - " << (int) dst_label;
             size_t idx = edge_label_to_index(src_label, edge_label, dst_label);
+            std::string suffix = std::to_string(src_label) + "_" +
+                                 std::to_string(edge_label) + "_" +
+                                 std::to_string(dst_label);
             if (schema_.oe_is_single(src_label, edge_label, dst_label)) {
               oe_[idx] = new SCsr();
             } else {
-              oe_[idx] = new Csr();
+              oe_[idx] = create_csr(
+                  schema_.oe_layout(src_label, edge_label, dst_label));
             }
             if (schema_.ie_is_single(src_label, edge_label, dst_label)) {
               ie_[idx] = new SCsr();
             } else {
-              ie_[idx] = new Csr();
+              ie_[idx] = create_csr(
+                  schema_.ie_layout(src_label, edge_label, dst_label));
             }
-            ie_[idx]->open(partition_binary_prefix + "/ie_" +
-                           std::to_string(src_label) + "_" +
-                           std::to_string(edge_label) + "_" +
-                           std::to_string(dst_label));
-            oe_[idx]->open(partition_binary_prefix + "/oe_" +
-                           std::to_string(src_label) + "_" +
-                           std::to_string(edge_label) + "_" +
-                           std::to_string(dst_label));
+            ICsr* ie = ie_[idx];
+            ICsr* oe = oe_[idx];
+            std::string ie_prefix = partition_binary_prefix + "/ie_" + suffix;
+            std::string oe_prefix = partition_binary_prefix + "/oe_" + suffix;
+            bool ie_sorted =
+                schema_.ie_is_sorted(src_label, edge_label, dst_label);
+            bool oe_sorted =
+                schema_.oe_is_sorted(src_label, edge_label, dst_label);
+            submit(csr_phase,
+                   [ie, ie_prefix, ie_sorted, strategy, encoding]() {
+                     ie->open(ie_prefix, strategy, encoding);
+                     if (ie_sorted && !ie->is_sorted()) {
+                       LOG(WARNING) << "sorting " << ie_prefix
+                                    << ", run encode_neighbors to sort it once";
+                       ie->sort_neighbors();
+                     }
+                   });
+            submit(csr_phase,
+                   [oe, oe_prefix, oe_sorted, strategy, encoding]() {
+                     oe->open(oe_prefix, strategy, encoding);
+                     if (oe_sorted && !oe->is_sorted()) {
+                       LOG(WARNING) << "sorting " << oe_prefix
+                                    << ", run encode_neighbors to sort it once";
+                       oe->sort_neighbors();
+                     }
+                   });
+
             const auto& header =
                 schema_.get_edge_header(src_label, edge_label, dst_label);
             if (header.size() > 0) {
-              ie_props_[idx].open(partition_binary_prefix + "/iep_" +
-                                      std::to_string(src_label) + "_" +
-                                      std::to_string(edge_label) + "_" +
-                                      std::to_string(dst_label),
-                                  header);
-              oe_props_[idx].open(partition_binary_prefix + "/oep_" +
-                                      std::to_string(src_label) + "_" +
-                                      std::to_string(edge_label) + "_" +
-                                      std::to_string(dst_label),
-                                  header);
+              auto& ie_table = ie_props_[idx];
+              auto& oe_table = oe_props_[idx];
+              ie_table.init(header);
+              oe_table.init(header);
+              std::string iep_prefix =
+                  partition_binary_prefix + "/iep_" + suffix;
+              std::string oep_prefix =
+                  partition_binary_prefix + "/oep_" + suffix;
+              for (size_t col_i = 0; col_i < header.size(); ++col_i) {
+                submit(edge_prop_phase,
+                       [&ie_table, iep_prefix, col_i, strategy]() {
+                         ie_table.open_column(iep_prefix, col_i, strategy);
+                       });
+                submit(edge_prop_phase,
+                       [&oe_table, oep_prefix, col_i, strategy]() {
+                         oe_table.open_column(oep_prefix, col_i, strategy);
+                       });
+              }
             }
           }
         }
       }
     }
-    LOG(INFO) << "after open csrs...";
+
+    pool.wait();
+
+    for (auto& table : vertex_props_) {
+      table.update_row_num();
+    }
+    for (auto& pair : ie_props_) {
+      pair.second.update_row_num();
+    }
+    for (auto& pair : oe_props_) {
+      pair.second.update_row_num();
+    }
+
+    size_t csr_memory = 0;
+    for (auto csr : ie_) {
+      csr_memory += (csr == nullptr) ? 0 : csr->memory_usage();
+    }
+    for (auto csr : oe_) {
+      csr_memory += (csr == nullptr) ? 0 : csr->memory_usage();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    LOG(INFO) << "open partition " << partition_id_ << " with "
+              << pool.thread_num() << " threads takes "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end -
+                                                                       start)
+                         .count() /
+                     1000000.0
+              << " s";
+    for (auto* phase : {&vertex_map_phase, &vertex_prop_phase, &csr_phase,
+                        &edge_prop_phase}) {
+      LOG(INFO) << phase->name << ": " << phase->task_num << " tasks, busy "
+                << phase->busy_us.load() / 1000000.0 << " s, finished at "
+                << phase->finish_us.load() / 1000000.0 << " s";
+    }
+    LOG(INFO) << "csrs take " << csr_memory << " bytes";
   }
 
   GraphView get_graph_view(label_t src_label, label_t edge_label,
@@ -134,14 +264,26 @@ class GraphDB {
     }
   }
 
+  // Compressed triplets cannot be read through ICsr, see
+  // get_compressed_graph_view.
   const ICsr* get_csr(label_t src_label, label_t edge_label, label_t dst_label,
                       Direction dir) const {
-    size_t idx = edge_label_to_index(src_label, edge_label, dst_label);
-    if (dir == Direction::kOutgoing) {
-      return oe_[idx];
-    } else {
-      return ie_[idx];
-    }
+    const ICsr* csr = find_csr(src_label, edge_label, dst_label, dir);
+    CHECK(dynamic_cast<const CompressedCsr*>(csr) == nullptr)
+        << "(" << static_cast<int>(src_label) << ", "
+        << static_cast<int>(edge_label) << ", "
+        << static_cast<int>(dst_label)
+        << ") is compressed, use get_compressed_graph_view";
+    return csr;
+  }
+
+  // Only valid for triplets with the compressed layout.
+  CompressedGraphView get_compressed_graph_view(label_t src_label,
+                                                label_t edge_label,
+                                                label_t dst_label,
+                                                Direction dir) const {
+    return CompressedGraphView(
+        find_csr(src_label, edge_label, dst_label, dir));
   }
 
   const IColumn* get_vertex_property(label_t label,
@@ -149,11 +291,76 @@ class GraphDB {
     return vertex_props_[label].get_column_by_name(name);
   }
 
+  // Appends the vertices of label whose property name equals value, through
+  // the secondary index declared with "indexed" in the schema. Returns false
+  // if the property is not indexed or value does not match its type.
+  template <typename VALUE_T>
+  bool lookup_vertices(label_t label, const std::string& name,
+                       const VALUE_T& value,
+                       std::vector<vertex_t>& vertices) const {
+    return vertex_props_[label].lookup(name, value, vertices);
+  }
+
+  // Column of an edge property, indexed by the offsets of
+  // ICsr::get_edges_with_offset on the same direction. nullptr if the triplet
+  // has no such property.
+  const IColumn* get_edge_property(label_t src_label, label_t edge_label,
+                                   label_t dst_label, Direction dir,
+                                   const std::string& name) const {
+    size_t idx = edge_label_to_index(src_label, edge_label, dst_label);
+    const auto& props = dir == Direction::kOutgoing ? oe_props_ : ie_props_;
+    auto iter = props.find(idx);
+    if (iter == props.end()) {
+      return nullptr;
+    }
+    return iter->second.get_column_by_name(name);
+  }
+
   const VertexMap& vertex_map() const { return vertex_map_; }
 
+  NeighborEncoding neighbor_encoding() const { return neighbor_encoding_; }
+
   const Schema& schema() const { return schema_; }
 
  private:
+  const ICsr* find_csr(label_t src_label, label_t edge_label,
+                       label_t dst_label, Direction dir) const {
+    size_t idx = edge_label_to_index(src_label, edge_label, dst_label);
+    if (dir == Direction::kOutgoing) {
+      return oe_[idx];
+    } else {
+      return ie_[idx];
+    }
+  }
+
+  static ICsr* create_csr(CsrLayout layout) {
+    switch (layout) {
+    case CsrLayout::kCompact:
+      return new CompactCsr();
+    case CsrLayout::kCompressed:
+      return new CompressedCsr();
+    default:
+      return new Csr();
+    }
+  }
+
+  struct LoadPhase {
+    explicit LoadPhase(const std::string& phase_name)
+        : name(phase_name), task_num(0), busy_us(0), finish_us(0) {}
+
+    void record(int64_t task_us, int64_t end_us) {
+      busy_us += task_us;
+      int64_t prev = finish_us.load();
+      while (prev < end_us && !finish_us.compare_exchange_weak(prev, end_us)) {
+      }
+    }
+
+    std::string name;
+    size_t task_num;
+    std::atomic<int64_t> busy_us;
+    std::atomic<int64_t> finish_us;
+  };
+
   size_t edge_label_to_index(label_t src_label, label_t edge_label,
                              label_t dst_label) const {
     return static_cast<size_t>(src_label) *
@@ -168,6 +375,7 @@ class GraphDB {
   int partition_num_;
   label_t vertex_label_num_;
   label_t edge_label_num_;
+  NeighborEncoding neighbor_encoding_;
 
   std::vector<ICsr*> ie_;
   std::vector<ICsr*> oe_;
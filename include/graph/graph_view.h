@@ -1,14 +1,36 @@
 #ifndef LADDER_GRAPH_GRAPH_VIEW_H
 #define LADDER_GRAPH_GRAPH_VIEW_H
 
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "glog/logging.h"
+#include "graph/compact_csr.h"
+#include "graph/compressed_csr.h"
 #include "graph/csr.h"
 #include "graph/scsr.h"
+#include "graph/vertex_map.h"
+#include "property/column.h"
 
 namespace ladder {
 
+// One edge of a batched expansion: the position of its source vertex in the
+// batch, and the neighbor.
+struct ExpandedEdge {
+  size_t src_idx;
+  gid_t neighbor;
+};
+
+// Works with the plain and compact multi-edge layouts, at the cost of a
+// virtual call per access. See TypedGraphView for hot loops, and
+// CompressedGraphView for the compressed layout, which construction refuses.
 class GraphView {
  public:
-  GraphView(const ICsr* csr) : csr_(*dynamic_cast<const Csr*>(csr)) {}
+  GraphView(const ICsr* csr) : csr_(*csr) {
+    CHECK(dynamic_cast<const CompressedCsr*>(csr) == nullptr)
+        << "compressed lists are only read through CompressedGraphView";
+  }
   ~GraphView() = default;
 
   AdjList get_edges(vertex_t v) const { return csr_.get_edges(v); }
@@ -18,28 +40,176 @@ class GraphView {
   AdjOffsetList get_edges_with_offset(vertex_t v) const {
     return csr_.get_edges_with_offset(v);
   }
+  bool has_edge(vertex_t v, gid_t nbr) const { return csr_.has_edge(v, nbr); }
 
  private:
-  const Csr& csr_;
+  const ICsr& csr_;
 };
 
-class SingleGraphView {
+// Adjacency access specialized at compile time for one csr layout. The csr
+// classes are final, so calls through a typed view are resolved statically
+// and inlined into operator loops, unlike calls through ICsr. Construction
+// throws std::bad_cast if the csr has a different layout.
+//
+// ENC must match the encoding the graph was opened with, which construction
+// checks, and selects how neighbors returned by the view are routed and
+// resolved.
+template <typename CSR_T, NeighborEncoding ENC = NeighborEncoding::kGlobal>
+class TypedGraphView {
+  static_assert(!std::is_same<CSR_T, CompressedCsr>::value,
+                "compressed lists are read through CompressedGraphView");
+
  public:
-  SingleGraphView(const ICsr* csr) : scsr_(*dynamic_cast<const SCsr*>(csr)) {}
-  ~SingleGraphView() = default;
+  using csr_type = CSR_T;
+  static constexpr NeighborEncoding encoding = ENC;
 
-  AdjList get_edges(vertex_t v) const { return scsr_.get_edges(v); }
+  TypedGraphView(const ICsr* csr) : csr_(dynamic_cast<const CSR_T&>(*csr)) {
+    CHECK(csr->encoding() == ENC)
+        << "graph opened with "
+        << (csr->encoding() == NeighborEncoding::kLocal ? "local" : "global")
+        << " neighbor ids, but the view reads them as "
+        << (ENC == NeighborEncoding::kLocal ? "local" : "global");
+  }
+  ~TypedGraphView() = default;
+
+  int degree(vertex_t v) const { return csr_.degree(v); }
+  AdjList get_edges(vertex_t v) const { return csr_.get_edges(v); }
   AdjList get_partial_edges(vertex_t v, int part_i, int part_num) const {
-    return scsr_.get_partial_edges(v, part_i, part_num);
+    return csr_.get_partial_edges(v, part_i, part_num);
   }
   AdjOffsetList get_edges_with_offset(vertex_t v) const {
-    return scsr_.get_edges_with_offset(v);
+    return csr_.get_edges_with_offset(v);
+  }
+  bool has_edge(vertex_t v, gid_t nbr) const {
+    AdjList edges = csr_.get_edges(v);
+    const gid_t* begin = edges.data();
+    const gid_t* end = begin + edges.size();
+    if (csr_.is_sorted()) {
+      return std::binary_search(begin, end, nbr);
+    }
+    return std::find(begin, end, nbr) != end;
+  }
+
+  // Appends the edges of vertices[0, num) to out, in order. The offsets of
+  // upcoming vertices are prefetched 2 * PREFETCH_DISTANCE ahead and their
+  // neighbor lists PREFETCH_DISTANCE ahead, so that the cache misses of a
+  // batch overlap. Invalid vertices have no edges.
+  void expand(const vertex_t* vertices, size_t num,
+              std::vector<ExpandedEdge>& out) const {
+    expand_with(vertices, num, out,
+                [this](vertex_t v) { return csr_.get_edges(v); });
+  }
+
+  // Like expand, with get_partial_edges.
+  void expand_partial(const vertex_t* vertices, size_t num, int part_i,
+                      int part_num, std::vector<ExpandedEdge>& out) const {
+    expand_with(vertices, num, out, [&](vertex_t v) {
+      return csr_.get_partial_edges(v, part_i, part_num);
+    });
+  }
+
+  // Worker to send a neighbor to.
+  static inline int get_partition(gid_t nbr, int worker_num, int server_num) {
+    if constexpr (ENC == NeighborEncoding::kLocal) {
+      return get_local_partition(nbr, worker_num);
+    } else {
+      return ladder::get_partition(nbr, worker_num, server_num);
+    }
+  }
+
+  // Vertex of a neighbor, only valid on the worker it was routed to.
+  static inline bool get_internal_id(const VertexMap& vertex_map, gid_t nbr,
+                                     vertex_t& internal_id) {
+    if constexpr (ENC == NeighborEncoding::kLocal) {
+      internal_id = VertexMap::get_local_vertex(nbr);
+      return true;
+    } else {
+      return vertex_map.get_internal_id(nbr, internal_id);
+    }
+  }
+
+ private:
+  static constexpr size_t PREFETCH_DISTANCE = 8;
+
+  template <typename GET_T>
+  void expand_with(const vertex_t* vertices, size_t num,
+                   std::vector<ExpandedEdge>& out, const GET_T& get) const {
+    for (size_t i = 0; i < std::min(num, 2 * PREFETCH_DISTANCE); ++i) {
+      csr_.prefetch_vertex(vertices[i]);
+    }
+    for (size_t i = 0; i < num; ++i) {
+      if (i + 2 * PREFETCH_DISTANCE < num) {
+        csr_.prefetch_vertex(vertices[i + 2 * PREFETCH_DISTANCE]);
+      }
+      if (i + PREFETCH_DISTANCE < num) {
+        csr_.prefetch_edges(vertices[i + PREFETCH_DISTANCE]);
+      }
+      for (gid_t nbr : get(vertices[i])) {
+        out.push_back({i, nbr});
+      }
+    }
+  }
+
+  const CSR_T& csr_;
+};
+
+using SingleGraphView = TypedGraphView<SCsr>;
+
+// Access to a CompressedCsr. Lists are decoded while iterating and point into
+// the csr, so any number of them stay valid as long as the graph is open.
+class CompressedGraphView {
+ public:
+  CompressedGraphView(const ICsr* csr)
+      : csr_(dynamic_cast<const CompressedCsr&>(*csr)) {}
+  ~CompressedGraphView() = default;
+
+  int degree(vertex_t v) const { return csr_.degree(v); }
+
+  CompressedAdjList get_edges(vertex_t v) const {
+    return csr_.get_compressed_edges(v);
+  }
+  CompressedAdjList get_partial_edges(vertex_t v, int part_i,
+                                      int part_num) const {
+    return csr_.get_compressed_partial_edges(v, part_i, part_num);
   }
+  bool has_edge(vertex_t v, gid_t nbr) const { return csr_.has_edge(v, nbr); }
+
+ private:
+  const CompressedCsr& csr_;
+};
+
+// Typed access to a numeric edge property column, see
+// GraphDB::get_edge_property. Values are read in place, indexed by
+// AdjOffsetList offsets. Construction throws std::bad_cast if the column holds
+// a different type.
+template <typename T>
+class EdgePropertyView {
+ public:
+  EdgePropertyView(const IColumn* column)
+      : column_(dynamic_cast<const NumericColumn<T>&>(*column)) {}
+  ~EdgePropertyView() = default;
+
+  inline T get(size_t offset) const { return column_.get(offset); }
 
  private:
-  const SCsr& scsr_;
+  const NumericColumn<T>& column_;
 };
 
+// Calls func(neighbor, value) for every edge of v whose property value
+// satisfies pred, reading neighbors and values in the same pass.
+template <typename VIEW_T, typename T, typename PRED_T, typename FUNC_T>
+inline void foreach_edge_if(const VIEW_T& view, vertex_t v,
+                            const EdgePropertyView<T>& prop,
+                            const PRED_T& pred, const FUNC_T& func) {
+  AdjOffsetList edges = view.get_edges_with_offset(v);
+  for (auto it = edges.begin(); it != edges.end(); ++it) {
+    T value = prop.get(it.get_offset());
+    if (pred(value)) {
+      func(it.get_neighbor(), value);
+    }
+  }
+}
+
 }  // namespace ladder
 
 #endif  // LADDER_GRAPH_GRAPH_VIEW_H
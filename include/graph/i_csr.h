@@ -3,15 +3,37 @@
 
 #include <stddef.h>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "graph/types.h"
+#include "mmap_array.h"
 
 namespace ladder {
 
+inline std::string neighbor_list_fname(const std::string& prefix,
+                                      NeighborEncoding encoding) {
+  return prefix + (encoding == NeighborEncoding::kLocal ? "_lnbrs" : "_nbrs");
+}
+
+// Bit of "<prefix>_meta"[1] that is set once every list of the neighbor file
+// of encoding is sorted, see Csr::sort_lists.
+inline size_t sorted_lists_flag(NeighborEncoding encoding) {
+  return encoding == NeighborEncoding::kLocal ? 2 : 1;
+}
+
+inline bool lists_are_sorted(const std::vector<size_t>& meta,
+                             NeighborEncoding encoding) {
+  return meta.size() > 1 && (meta[1] & sorted_lists_flag(encoding)) != 0;
+}
+
 class ICsr {
  public:
   virtual ~ICsr() = default;
 
-  virtual void open(const std::string& prefix) = 0;
+  virtual void open(const std::string& prefix, StorageStrategy strategy,
+                    NeighborEncoding encoding) = 0;
 
   virtual size_t vertex_num() const = 0;
   virtual size_t edge_num() const = 0;
@@ -21,6 +43,30 @@ class ICsr {
   virtual AdjList get_partial_edges(vertex_t u, int part_i,
                                     int part_num) const = 0;
   virtual AdjOffsetList get_edges_with_offset(vertex_t u) const = 0;
+
+  // Sorts every adjacency list in place. Only valid for triplets without
+  // edge properties, since it reorders edges.
+  virtual void sort_neighbors() = 0;
+  virtual bool is_sorted() const = 0;
+
+  // Binary search on sorted lists, linear scan otherwise.
+  virtual bool has_edge(vertex_t u, gid_t v) const {
+    AdjList edges = get_edges(u);
+    if (is_sorted()) {
+      return std::binary_search(edges.data(), edges.data() + edges.size(), v);
+    }
+    return std::find(edges.data(), edges.data() + edges.size(), v) !=
+           edges.data() + edges.size();
+  }
+
+  // Bytes held by the adjacency structure, mapped or not.
+  virtual size_t memory_usage() const = 0;
+
+  // Encoding of the neighbor ids, set by open().
+  NeighborEncoding encoding() const { return encoding_; }
+
+ protected:
+  NeighborEncoding encoding_ = NeighborEncoding::kGlobal;
 };
 
 }  // namespace ladder
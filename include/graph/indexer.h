@@ -1,10 +1,15 @@
 #ifndef LADDER_GRAPH_INDEXER_H
 #define LADDER_GRAPH_INDEXER_H
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "graph/types.h"
+#include "mmap_array.h"
 #include "utils.h"
 
 namespace ladder {
@@ -17,6 +22,8 @@ size_t hash_vertex(gid_t x) {
 }
 
 class Indexer {
+  // Power of two, and only ever doubled, so that table sizes stay powers of
+  // two and buckets can be computed with a mask.
   static constexpr size_t INITIAL_SIZE = 16;
   static constexpr double MAX_LOAD_FACTOR = 0.875;
   static size_t calc_table_size(size_t keys_size) {
@@ -33,25 +40,30 @@ class Indexer {
 
  public:
   Indexer() = default;
+  Indexer(Indexer&& rhs) = default;
   ~Indexer() = default;
 
-  void open(const std::string& prefix) {
+  // Without persisted indices, the table is built with up to
+  // build_thread_num threads.
+  void open(const std::string& prefix, StorageStrategy strategy,
+            int build_thread_num = 1) {
     std::string key_fname = prefix + "_keys";
-    load_from_file(key_fname, keys_);
+    keys_.open(key_fname, strategy);
 
-    size_t table_size = calc_table_size(keys_.size());
-    indices_.clear();
-    indices_.resize(table_size, std::numeric_limits<vertex_t>::max());
-
-    for (vertex_t i = 0; i < keys_.size(); ++i) {
-      size_t hash = hash_vertex(keys_[i]) % table_size;
-      while (indices_[hash] != std::numeric_limits<vertex_t>::max()) {
-        hash = (hash + 1) % table_size;
-      }
-      indices_[hash] = i;
+    if (!load_indices(prefix, strategy)) {
+      build_indices(build_thread_num);
     }
   }
 
+  // Persists the hash table next to the keys, so that later opens can load
+  // or map it instead of rebuilding.
+  bool dump_indices(const std::string& prefix) const {
+    std::vector<size_t> meta = {keys_.size(), indices_.size(), HASH_VERSION};
+    return dump_to_file(prefix + "_indices", indices_.data(),
+                        indices_.size()) &&
+           dump_to_file(prefix + "_indices_meta", meta.data(), meta.size());
+  }
+
   bool get_key(size_t index, gid_t& key) const {
     if (index >= keys_.size()) {
       return false;
@@ -61,10 +73,54 @@ class Indexer {
   }
 
   bool get_index(gid_t key, vertex_t& index) const {
-    size_t table_size = indices_.size();
-    size_t hash = hash_vertex(key) % table_size;
+    return probe(key, bucket(key), index);
+  }
+
+  // Resolves a block of keys at once: all home buckets are hashed and
+  // prefetched first, then the candidate keys, and only then probed, so the
+  // cache misses of independent lookups overlap. Keys that are not found get
+  // std::numeric_limits<vertex_t>::max(). Returns the number of keys found.
+  size_t get_indices(const gid_t* keys, size_t num, vertex_t* indices) const {
+    size_t found = 0;
+    size_t buckets[LOOKUP_BLOCK];
+    for (size_t i = 0; i < num; i += LOOKUP_BLOCK) {
+      size_t block = std::min(LOOKUP_BLOCK, num - i);
+      for (size_t j = 0; j < block; ++j) {
+        buckets[j] = bucket(keys[i + j]);
+        prefetch_bucket(buckets[j]);
+      }
+      for (size_t j = 0; j < block; ++j) {
+        prefetch_key(buckets[j]);
+      }
+      for (size_t j = 0; j < block; ++j) {
+        if (probe(keys[i + j], buckets[j], indices[i + j])) {
+          ++found;
+        } else {
+          indices[i + j] = std::numeric_limits<vertex_t>::max();
+        }
+      }
+    }
+    return found;
+  }
+
+  // Building blocks of the batched lookup, also used by VertexMap to
+  // pipeline keys of different labels.
+  inline size_t bucket(gid_t key) const { return hash_vertex(key) & mask_; }
+
+  inline void prefetch_bucket(size_t bucket) const {
+    __builtin_prefetch(&indices_[bucket]);
+  }
+
+  inline void prefetch_key(size_t bucket) const {
+    auto idx = indices_[bucket];
+    if (idx != std::numeric_limits<vertex_t>::max()) {
+      __builtin_prefetch(&keys_[idx]);
+    }
+  }
+
+  inline bool probe(gid_t key, size_t bucket, vertex_t& index) const {
     while (true) {
-      auto idx = indices_[hash];
+      auto idx = indices_[bucket];
       if (idx == std::numeric_limits<vertex_t>::max()) {
         return false;
       }
@@ -72,16 +128,93 @@ class Indexer {
         index = idx;
         return true;
       }
-      hash = (hash + 1) % table_size;
+      bucket = (bucket + 1) & mask_;
     }
     return false;
   }
 
+  static constexpr size_t LOOKUP_BLOCK = 32;
+
   size_t size() const { return keys_.size(); }
 
  private:
-  std::vector<gid_t> keys_;
-  std::vector<vertex_t> indices_;
+  bool load_indices(const std::string& prefix, StorageStrategy strategy) {
+    std::string meta_fname = prefix + "_indices_meta";
+    if (!file_exists(meta_fname)) {
+      return false;
+    }
+    std::vector<size_t> meta;
+    load_from_file(meta_fname, meta);
+    size_t table_size = calc_table_size(keys_.size());
+    if (meta.size() != 3 || meta[0] != keys_.size() ||
+        meta[1] != table_size || meta[2] != HASH_VERSION) {
+      std::cerr << "Warning: stale indices for " << prefix << ", rebuilding"
+                << std::endl;
+      return false;
+    }
+    indices_.open(prefix + "_indices", strategy);
+    mask_ = indices_.size() - 1;
+    return indices_.size() == table_size;
+  }
+
+  void build_indices(int thread_num) {
+    static constexpr vertex_t EMPTY = std::numeric_limits<vertex_t>::max();
+    size_t table_size = calc_table_size(keys_.size());
+    size_t mask = table_size - 1;
+    std::vector<vertex_t> indices(table_size, EMPTY);
+
+    size_t key_num = keys_.size();
+    if (key_num < PARALLEL_BUILD_THRESHOLD || thread_num <= 1) {
+      for (vertex_t i = 0; i < key_num; ++i) {
+        size_t hash = hash_vertex(keys_[i]) & mask;
+        while (indices[hash] != EMPTY) {
+          hash = (hash + 1) & mask;
+        }
+        indices[hash] = i;
+      }
+    } else {
+      // Slots are claimed with CAS, so the probe order may differ from the
+      // sequential build but every key stays reachable from its home slot.
+      std::vector<std::atomic<vertex_t>> slots(table_size);
+      for (auto& slot : slots) {
+        slot.store(EMPTY, std::memory_order_relaxed);
+      }
+      std::vector<std::thread> threads;
+      size_t chunk = (key_num + thread_num - 1) / thread_num;
+      for (int t = 0; t < thread_num; ++t) {
+        threads.emplace_back([&, t]() {
+          vertex_t begin = std::min(key_num, t * chunk);
+          vertex_t end = std::min(key_num, begin + chunk);
+          for (vertex_t i = begin; i < end; ++i) {
+            size_t hash = hash_vertex(keys_[i]) & mask;
+            vertex_t expected = EMPTY;
+            while (!slots[hash].compare_exchange_strong(
+                expected, i, std::memory_order_relaxed)) {
+              expected = EMPTY;
+              hash = (hash + 1) & mask;
+            }
+          }
+        });
+      }
+      for (auto& thrd : threads) {
+        thrd.join();
+      }
+      for (size_t i = 0; i < table_size; ++i) {
+        indices[i] = slots[i].load(std::memory_order_relaxed);
+      }
+    }
+    indices_.assign(std::move(indices));
+    mask_ = mask;
+  }
+
+  // Bumped whenever hash_vertex or the probing scheme changes.
+  static constexpr size_t HASH_VERSION = 1;
+  static constexpr size_t PARALLEL_BUILD_THRESHOLD = 1 << 20;
+
+  MmapArray<gid_t> keys_;
+  // Always a power-of-two table, probed with mask_ instead of a modulo.
+  MmapArray<vertex_t> indices_;
+  size_t mask_;
 };
 
 }  // namespace ladder
@@ -0,0 +1,123 @@
+#ifndef LADDER_GRAPH_INTERSECT_H
+#define LADDER_GRAPH_INTERSECT_H
+
+#include <algorithm>
+#include <vector>
+
+#include "cpu_features.h"
+#include "graph/types.h"
+
+#ifdef LADDER_HAS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace ladder {
+
+// Lists whose lengths differ by more than this factor are intersected by
+// galloping through the longer one instead of merging.
+static constexpr int GALLOP_RATIO = 32;
+
+inline const gid_t* gallop_lower_bound(const gid_t* begin, const gid_t* end,
+                                       gid_t v) {
+  size_t step = 1;
+  const gid_t* lo = begin;
+  while (lo + step < end && lo[step] < v) {
+    lo += step;
+    step <<= 1;
+  }
+  return std::lower_bound(lo, std::min(lo + step + 1, end), v);
+}
+
+inline void intersect_gallop(const gid_t* small, size_t small_size,
+                             const gid_t* large, size_t large_size,
+                             std::vector<gid_t>& out) {
+  const gid_t* cur = large;
+  const gid_t* end = large + large_size;
+  for (size_t i = 0; i < small_size && cur != end; ++i) {
+    cur = gallop_lower_bound(cur, end, small[i]);
+    if (cur != end && *cur == small[i]) {
+      out.push_back(small[i]);
+      ++cur;
+    }
+  }
+}
+
+#ifdef LADDER_HAS_X86_KERNELS
+// Compares blocks of 4 against 4 through all rotations of the b block, then
+// advances whichever block has the smaller maximum. Leaves i and j where
+// fewer than 4 elements remain in either list.
+LADDER_TARGET_AVX2 inline void intersect_merge_avx2(const gid_t* a,
+                                                    size_t a_size,
+                                                    const gid_t* b,
+                                                    size_t b_size, size_t& i,
+                                                    size_t& j,
+                                                    std::vector<gid_t>& out) {
+  while (i + 4 <= a_size && j + 4 <= b_size) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+    __m256i cmp = _mm256_cmpeq_epi64(va, vb);
+    vb = _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1));
+    cmp = _mm256_or_si256(cmp, _mm256_cmpeq_epi64(va, vb));
+    vb = _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1));
+    cmp = _mm256_or_si256(cmp, _mm256_cmpeq_epi64(va, vb));
+    vb = _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1));
+    cmp = _mm256_or_si256(cmp, _mm256_cmpeq_epi64(va, vb));
+    int mask = _mm256_movemask_pd(_mm256_castsi256_pd(cmp));
+    while (mask != 0) {
+      int k = __builtin_ctz(mask);
+      out.push_back(a[i + k]);
+      mask &= mask - 1;
+    }
+    gid_t a_max = a[i + 3];
+    gid_t b_max = b[j + 3];
+    if (a_max <= b_max) {
+      i += 4;
+    }
+    if (b_max <= a_max) {
+      j += 4;
+    }
+  }
+}
+#endif
+
+inline void intersect_merge(const gid_t* a, size_t a_size, const gid_t* b,
+                            size_t b_size, std::vector<gid_t>& out) {
+  size_t i = 0, j = 0;
+#ifdef LADDER_HAS_X86_KERNELS
+  if (cpu_has_avx2()) {
+    intersect_merge_avx2(a, a_size, b, b_size, i, j, out);
+  }
+#endif
+  while (i < a_size && j < b_size) {
+    if (a[i] < b[j]) {
+      ++i;
+    } else if (b[j] < a[i]) {
+      ++j;
+    } else {
+      out.push_back(a[i]);
+      ++i;
+      ++j;
+    }
+  }
+}
+
+// Appends the common neighbors of two sorted, duplicate-free adjacency lists
+// to out, in ascending order.
+inline void intersect(const AdjList& a, const AdjList& b,
+                      std::vector<gid_t>& out) {
+  size_t a_size = a.size(), b_size = b.size();
+  if (a_size == 0 || b_size == 0) {
+    return;
+  }
+  if (a_size * GALLOP_RATIO < b_size) {
+    intersect_gallop(a.data(), a_size, b.data(), b_size, out);
+  } else if (b_size * GALLOP_RATIO < a_size) {
+    intersect_gallop(b.data(), b_size, a.data(), a_size, out);
+  } else {
+    intersect_merge(a.data(), a_size, b.data(), b_size, out);
+  }
+}
+
+}  // namespace ladder
+
+#endif  // LADDER_GRAPH_INTERSECT_H
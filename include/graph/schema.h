@@ -18,6 +18,12 @@ enum class PartitionType {
   kStatic,
 };
 
+enum class CsrLayout {
+  kDefault,
+  kCompact,
+  kCompressed,
+};
+
 struct LabelTriplet {
  public:
   LabelTriplet(label_t src, label_t edge, label_t dst)
@@ -59,6 +65,22 @@ class Schema {
     return vertex_prop_vec_.at(label);
   }
 
+  bool vertex_prop_is_dictionary(label_t label, size_t prop_idx) const {
+    return vertex_prop_dictionary_.at(label).count(prop_idx) != 0;
+  }
+
+  bool vertex_prop_is_indexed(label_t label, size_t prop_idx) const {
+    return vertex_prop_indexed_.at(label).count(prop_idx) != 0;
+  }
+
+  bool vertex_prop_has_zone_map(label_t label, size_t prop_idx) const {
+    return vertex_prop_zone_map_.at(label).count(prop_idx) != 0;
+  }
+
+  bool vertex_prop_has_sorted_index(label_t label, size_t prop_idx) const {
+    return vertex_prop_sorted_index_.at(label).count(prop_idx) != 0;
+  }
+
   bool oe_is_single(label_t src, label_t edge, label_t dst) const {
     return oe_single_.find(LabelTriplet(src, edge, dst)) != oe_single_.end();
   }
@@ -67,6 +89,24 @@ class Schema {
     return ie_single_.find(LabelTriplet(src, edge, dst)) != ie_single_.end();
   }
 
+  CsrLayout oe_layout(label_t src, label_t edge, label_t dst) const {
+    auto it = oe_layout_.find(LabelTriplet(src, edge, dst));
+    return it == oe_layout_.end() ? CsrLayout::kDefault : it->second;
+  }
+
+  CsrLayout ie_layout(label_t src, label_t edge, label_t dst) const {
+    auto it = ie_layout_.find(LabelTriplet(src, edge, dst));
+    return it == ie_layout_.end() ? CsrLayout::kDefault : it->second;
+  }
+
+  bool oe_is_sorted(label_t src, label_t edge, label_t dst) const {
+    return oe_sorted_.find(LabelTriplet(src, edge, dst)) != oe_sorted_.end();
+  }
+
+  bool ie_is_sorted(label_t src, label_t edge, label_t dst) const {
+    return ie_sorted_.find(LabelTriplet(src, edge, dst)) != ie_sorted_.end();
+  }
+
   bool exist_edge_triplet(label_t src, label_t edge, label_t dst) const {
     return edge_prop_meta_.find(LabelTriplet(src, edge, dst)) !=
            edge_prop_meta_.end();
@@ -85,6 +125,10 @@ class Schema {
       vertex_prop_meta_;
   std::vector<std::vector<std::pair<std::string, DataType>>> vertex_prop_vec_;
   std::vector<PartitionType> vertex_partition_type_;
+  std::vector<std::set<size_t>> vertex_prop_dictionary_;
+  std::vector<std::set<size_t>> vertex_prop_indexed_;
+  std::vector<std::set<size_t>> vertex_prop_zone_map_;
+  std::vector<std::set<size_t>> vertex_prop_sorted_index_;
 
   std::map<LabelTriplet,
            std::unordered_map<std::string, std::pair<DataType, size_t>>>
@@ -93,6 +137,10 @@ class Schema {
       edge_prop_vec_;
   std::set<LabelTriplet> ie_single_;
   std::set<LabelTriplet> oe_single_;
+  std::map<LabelTriplet, CsrLayout> ie_layout_;
+  std::map<LabelTriplet, CsrLayout> oe_layout_;
+  std::set<LabelTriplet> ie_sorted_;
+  std::set<LabelTriplet> oe_sorted_;
 };
 
 }  // namespace ladder
@@ -6,18 +6,21 @@
 
 #include "graph/i_csr.h"
 #include "graph/types.h"
+#include "mmap_array.h"
 #include "utils.h"
 
 namespace ladder {
 
-class SCsr : public ICsr {
+class SCsr final : public ICsr {
  public:
   SCsr() = default;
   ~SCsr() = default;
 
-  void open(const std::string& prefix) override {
-    std::string nbr_list_fname = prefix + "_nbrs";
-    load_from_file(nbr_list_fname, nbr_list_);
+  void open(const std::string& prefix, StorageStrategy strategy,
+            NeighborEncoding encoding) override {
+    encoding_ = encoding;
+    std::string nbr_list_fname = neighbor_list_fname(prefix, encoding);
+    nbr_list_.open(nbr_list_fname, strategy);
 
     std::vector<size_t> meta;
     std::string meta_fname = prefix + "_meta";
@@ -58,8 +61,26 @@ class SCsr : public ICsr {
                     : AdjOffsetList(&nbr_list_[u], deg, u);
   }
 
+  // The neighbor is stored in place of an offset.
+  inline void prefetch_vertex(vertex_t u) const {}
+
+  inline void prefetch_edges(vertex_t u) const {
+    if (u < nbr_list_.size()) {
+      __builtin_prefetch(&nbr_list_[u]);
+    }
+  }
+
+  // A single neighbor is trivially sorted.
+  void sort_neighbors() override {}
+
+  bool is_sorted() const override { return true; }
+
+  size_t memory_usage() const override {
+    return nbr_list_.size() * sizeof(gid_t);
+  }
+
  private:
-  std::vector<gid_t> nbr_list_;
+  MmapArray<gid_t> nbr_list_;
   size_t vertex_num_;
   size_t edge_num_;
 };
@@ -9,6 +9,14 @@ using label_t = uint8_t;
 using vertex_t = uint64_t;
 using gid_t = uint64_t;
 
+// How adjacency lists refer to neighbors: global ids, which have to be hashed
+// on every hop, or (owner server, owner-local vertex id) pairs, see
+// VertexMap::encode_local_id.
+enum class NeighborEncoding {
+  kGlobal,
+  kLocal,
+};
+
 class AdjList {
   class iterator {
    public:
@@ -46,6 +54,14 @@ class AdjList {
   iterator begin() const { return iterator(start_); }
   iterator end() const { return iterator(end_); }
 
+  const gid_t* data() const { return start_; }
+  int size() const { return end_ - start_; }
+
+  // Neighbors [begin, end) of this list.
+  AdjList slice(int begin, int end) const {
+    return AdjList(start_ + begin, end - begin);
+  }
+
   static AdjList empty() { return AdjList(nullptr, 0); }
 
  private:
@@ -3,35 +3,92 @@
 
 #include <vector>
 
+#include "glog/logging.h"
 #include "graph/indexer.h"
 
 namespace ladder {
 
-int get_partition(gid_t global_id, int worker_num, int server_num) {
+inline int get_partition(gid_t global_id, int worker_num, int server_num) {
   size_t magic_num = global_id / server_num;
   return (global_id - magic_num * server_num) * worker_num +
          magic_num % worker_num;
 }
 
+inline int get_server(gid_t global_id, int server_num) {
+  return global_id % server_num;
+}
+
 class VertexMap {
   static constexpr size_t LABEL_SHIFT_BITS =
       8 * (sizeof(gid_t) - sizeof(label_t));
   static constexpr gid_t OID_MASK = (1ULL << LABEL_SHIFT_BITS) - 1;
 
  public:
+  // Layout of partition-local ids: the label keeps the top byte, as in global
+  // ids, followed by the owner server and the vertex id on that server.
+  static constexpr size_t LOCAL_VID_BITS = 40;
+  static constexpr gid_t LOCAL_VID_MASK = (1ULL << LOCAL_VID_BITS) - 1;
+  static constexpr gid_t LOCAL_SERVER_MASK =
+      (1ULL << (LABEL_SHIFT_BITS - LOCAL_VID_BITS)) - 1;
+
+  // Fails if server_id or internal_id do not fit their bits.
+  static inline gid_t encode_local_id(label_t label, int server_id,
+                                      vertex_t internal_id) {
+    CHECK(server_id >= 0 &&
+          static_cast<gid_t>(server_id) <= LOCAL_SERVER_MASK)
+        << "server " << server_id << " does not fit a local id";
+    CHECK_LE(static_cast<gid_t>(internal_id), LOCAL_VID_MASK)
+        << "vertex " << internal_id << " does not fit a local id";
+    return (static_cast<gid_t>(label) << LABEL_SHIFT_BITS) |
+           (static_cast<gid_t>(server_id) << LOCAL_VID_BITS) | internal_id;
+  }
+
+  static inline int get_local_owner(gid_t local_id) {
+    return (local_id >> LOCAL_VID_BITS) & LOCAL_SERVER_MASK;
+  }
+
+  static inline vertex_t get_local_vertex(gid_t local_id) {
+    return local_id & LOCAL_VID_MASK;
+  }
+
   VertexMap() = default;
   ~VertexMap() = default;
 
-  void open(const std::string& prefix, label_t num_labels) {
+  void open(const std::string& prefix, label_t num_labels,
+            StorageStrategy strategy, int build_thread_num = 1) {
+    init(num_labels);
+    for (label_t i = 0; i < num_labels; ++i) {
+      open_label(prefix, i, strategy, build_thread_num);
+    }
+  }
+
+  // init() followed by one open_label() per label is equivalent to open(),
+  // and lets the labels be loaded concurrently.
+  void init(label_t num_labels) {
+    label_num_ = num_labels;
     indexers_.resize(num_labels);
     vertices_num_.resize(num_labels);
-    for (label_t i = 0; i < num_labels; ++i) {
-      indexers_[i].open(prefix + "_" + std::to_string(i));
-      vertices_num_[i] = indexers_[i].size();
+  }
+
+  // build_thread_num bounds the threads building a missing index, see
+  // Indexer::open.
+  void open_label(const std::string& prefix, label_t label,
+                  StorageStrategy strategy, int build_thread_num = 1) {
+    indexers_[label].open(prefix + "_" + std::to_string(label), strategy,
+                          build_thread_num);
+    vertices_num_[label] = indexers_[label].size();
+  }
+
+  bool dump_indices(const std::string& prefix) const {
+    for (label_t i = 0; i < label_num_; ++i) {
+      if (!indexers_[i].dump_indices(prefix + "_" + std::to_string(i))) {
+        return false;
+      }
     }
+    return true;
   }
 
-  inline label_t get_label_id(gid_t global_id) const {
+  static inline label_t get_label_id(gid_t global_id) {
     return static_cast<label_t>(global_id >> LABEL_SHIFT_BITS);
   }
 
@@ -40,6 +97,37 @@ class VertexMap {
     return indexers_[label].get_index(global_id, internal_id);
   }
 
+  // Batched get_internal_id, see Indexer::get_indices. Global ids of
+  // different labels can be mixed in one batch. Ids that are not found get
+  // std::numeric_limits<vertex_t>::max(). Returns the number found.
+  size_t get_internal_ids(const gid_t* global_ids, size_t num,
+                          vertex_t* internal_ids) const {
+    static constexpr size_t BLOCK = Indexer::LOOKUP_BLOCK;
+    size_t found = 0;
+    size_t buckets[BLOCK];
+    const Indexer* indexers[BLOCK];
+    for (size_t i = 0; i < num; i += BLOCK) {
+      size_t block = std::min(BLOCK, num - i);
+      for (size_t j = 0; j < block; ++j) {
+        indexers[j] = &indexers_[get_label_id(global_ids[i + j])];
+        buckets[j] = indexers[j]->bucket(global_ids[i + j]);
+        indexers[j]->prefetch_bucket(buckets[j]);
+      }
+      for (size_t j = 0; j < block; ++j) {
+        indexers[j]->prefetch_key(buckets[j]);
+      }
+      for (size_t j = 0; j < block; ++j) {
+        if (indexers[j]->probe(global_ids[i + j], buckets[j],
+                               internal_ids[i + j])) {
+          ++found;
+        } else {
+          internal_ids[i + j] = std::numeric_limits<vertex_t>::max();
+        }
+      }
+    }
+    return found;
+  }
+
   bool get_global_id(label_t label, vertex_t internal_id,
                      gid_t& global_id) const {
     return indexers_[label].get_key(internal_id, global_id);
@@ -58,6 +146,17 @@ class VertexMap {
 
   gid_t get_original_id(gid_t global_id) const { return global_id & OID_MASK; }
 
+  // Only valid on the owner server of local_id.
+  bool get_global_id_from_local(gid_t local_id, gid_t& global_id) const {
+    return get_global_id(get_label_id(local_id), get_local_vertex(local_id),
+                         global_id);
+  }
+
+  bool get_original_id_from_local(gid_t local_id, gid_t& original_id) const {
+    return get_original_id(get_label_id(local_id),
+                           get_local_vertex(local_id), original_id);
+  }
+
   size_t get_vertices_num(label_t label) const { return vertices_num_[label]; }
 
   bool is_valid_vertex(label_t label, vertex_t v) const {
@@ -72,6 +171,20 @@ class VertexMap {
   // std::vector<std::vector<bool>> tombs_;
 };
 
+// Routing of partition-local ids: the owner server is a shift away, and the
+// worker on that server is picked from the owner-local vertex id.
+//
+// The server agrees with get_partition on the global id of the same vertex,
+// but the worker usually does not: get_partition picks it from the global id,
+// which a local id does not carry. Every worker of a server can resolve the
+// vertex, so either choice is correct for expansion, but an operator that
+// groups records by vertex must receive all of them routed with the same
+// encoding.
+inline int get_local_partition(gid_t local_id, int worker_num) {
+  return VertexMap::get_local_owner(local_id) * worker_num +
+         VertexMap::get_local_vertex(local_id) % worker_num;
+}
+
 }  // namespace ladder
 
 #endif  // LADDER_GRAPH_VERTEX_MAP_H
@@ -0,0 +1,67 @@
+#ifndef LADDER_LADDER_CHANNEL_H_
+#define LADDER_LADDER_CHANNEL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace ladder {
+
+// Unbounded queue filled by a fixed number of producers. Each producer calls
+// close() once when it is done, and pop() fails once all have closed and the
+// queue is drained.
+template <typename T>
+class BlockingQueue {
+ public:
+  explicit BlockingQueue(int producer_num) : producer_num_(producer_num) {}
+  ~BlockingQueue() = default;
+
+  void push(T&& item) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      items_.emplace_back(std::move(item));
+    }
+    cv_.notify_one();
+  }
+
+  void close() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (--producer_num_ == 0) {
+      cv_.notify_all();
+    }
+  }
+
+  bool pop(T& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return !items_.empty() || producer_num_ == 0; });
+    if (items_.empty()) {
+      return false;
+    }
+    item = std::move(items_.front());
+    items_.pop_front();
+    return true;
+  }
+
+ private:
+  std::deque<T> items_;
+  int producer_num_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
+// Chunks of serialized records for one local worker. A chunk never splits a
+// record.
+using Channel = BlockingQueue<std::vector<char>>;
+
+// Takes the chunks an InStream flushes while its operator is still running.
+class ChunkSink {
+ public:
+  virtual ~ChunkSink() = default;
+  virtual void send_chunk(int dst, std::vector<char>&& chunk) = 0;
+};
+
+}  // namespace ladder
+
+#endif  // LADDER_LADDER_CHANNEL_H_
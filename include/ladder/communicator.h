@@ -3,9 +3,14 @@
 
 #include <mpi.h>
 
-#include <thread>
+#include <functional>
+#include <memory>
+#include <utility>
 #include <vector>
 
+#include "ladder/channel.h"
+#include "ladder/thread_group.h"
+
 namespace ladder {
 
 class CommSpec {
@@ -66,27 +71,29 @@ class MessageBatch {
 #define BUFFER_BATCH (1024 * 1024 * 16)
 
 void send_buffer(const void* data, size_t size, int dst_server_id,
-                 MPI_Comm comm) {
+                 MPI_Comm comm, int tag = 0) {
   int iter = size / BUFFER_BATCH;
   const char* ptr = static_cast<const char*>(data);
   for (int i = 0; i < iter; ++i) {
-    MPI_Send(ptr, BUFFER_BATCH, MPI_CHAR, dst_server_id, 0, comm);
+    MPI_Send(ptr, BUFFER_BATCH, MPI_CHAR, dst_server_id, tag, comm);
     ptr += BUFFER_BATCH;
   }
   size_t remaining = size % BUFFER_BATCH;
-  MPI_Send(ptr, remaining, MPI_CHAR, dst_server_id, 0, comm);
+  MPI_Send(ptr, remaining, MPI_CHAR, dst_server_id, tag, comm);
 }
 
-void recv_buffer(void* data, size_t size, int src_server_id, MPI_Comm comm) {
+void recv_buffer(void* data, size_t size, int src_server_id, MPI_Comm comm,
+                 int tag = 0) {
   int iter = size / BUFFER_BATCH;
   char* ptr = static_cast<char*>(data);
   for (int i = 0; i < iter; ++i) {
-    MPI_Recv(ptr, BUFFER_BATCH, MPI_CHAR, src_server_id, 0, comm,
+    MPI_Recv(ptr, BUFFER_BATCH, MPI_CHAR, src_server_id, tag, comm,
              MPI_STATUS_IGNORE);
     ptr += BUFFER_BATCH;
   }
   size_t remaining = size % BUFFER_BATCH;
-  MPI_Recv(ptr, remaining, MPI_CHAR, src_server_id, 0, comm, MPI_STATUS_IGNORE);
+  MPI_Recv(ptr, remaining, MPI_CHAR, src_server_id, tag, comm,
+           MPI_STATUS_IGNORE);
 }
 
 void send_vecs(const std::vector<std::vector<char>>& vecs, int dst_server_id,
@@ -126,64 +133,209 @@ void recv_vecs(std::vector<char>& vec, int src_server_id, MPI_Comm comm) {
 
 #undef BUFFER_BATCH
 
-class Communicator {
+// Shuffles either a whole MessageBatch at once, or, between stream_begin()
+// and stream_end(), chunks as producers hand them over. Streamed chunks for
+// other servers are shipped by a background send thread, each as a header
+// {local worker, size} and a payload, and a header with END_OF_STREAM tells
+// the receiver that a server has no more chunks.
+//
+// With a single server nothing is serialized twice or sent: buffers change
+// owner, and MPI is never called, so it need not be initialized.
+class Communicator : public ChunkSink {
+  static constexpr int STREAM_TAG = 1;
+  static constexpr size_t END_OF_STREAM = static_cast<size_t>(-1);
+  // Chunks for remote workers, keyed by global worker id.
+  using Outbox = BlockingQueue<std::pair<int, std::vector<char>>>;
+
  public:
-  Communicator(int server_id, const CommSpec& comm_spec)
-      : comm_spec_(comm_spec) {
+  // Shuffles send on the first of threads and receive on the second.
+  Communicator(int server_id, const CommSpec& comm_spec, ThreadGroup& threads)
+      : comm_spec_(comm_spec), threads_(threads) {
+    CHECK_EQ(threads.thread_num(), 2);
+    server_id_ = server_id;
+    if (single_server()) {
+      CHECK_EQ(server_id, 0);
+      return;
+    }
     MPI_Comm_dup(MPI_COMM_WORLD, &comm_);
     int rank, size;
     MPI_Comm_rank(comm_, &rank);
     MPI_Comm_size(comm_, &size);
     CHECK_EQ(rank, server_id);
     CHECK_EQ(size, comm_spec.server_num());
-
-    server_id_ = server_id;
   }
-  ~Communicator() { MPI_Comm_free(&comm_); }
+  ~Communicator() {
+    if (!single_server()) {
+      MPI_Comm_free(&comm_);
+    }
+  }
 
-  MessageBatch shuffle(MessageBatch&& input) {
-    CHECK_EQ(input.size(), comm_spec_.global_worker_num());
-    MessageBatch output(comm_spec_.local_worker_num());
+  bool single_server() const { return comm_spec_.server_num() == 1; }
 
-    std::thread send_thread([&, this]() {
+  // input may hold several parts, part p for global worker i at
+  // p * global_worker_num + i. All parts are exchanged in one round, and
+  // part p for local worker j is returned at p * local_worker_num + j.
+  MessageBatch shuffle(MessageBatch&& input) {
+    int global_worker_num = comm_spec_.global_worker_num();
+    int local_worker_num = comm_spec_.local_worker_num();
+    CHECK_EQ(input.size() % global_worker_num, 0);
+    if (single_server()) {
+      // Global and local worker ids coincide.
+      return std::move(input);
+    }
+    int part_num = input.size() / global_worker_num;
+    MessageBatch output(part_num * local_worker_num);
+
+    auto send = [&, this]() {
       for (int i = 1; i < comm_spec_.server_num(); ++i) {
         int target_server_id = (server_id_ + i) % comm_spec_.server_num();
-        for (int j = 0; j < comm_spec_.local_worker_num(); ++j) {
-          int global_worker_id =
-              comm_spec_.get_global_worker_id(target_server_id, j);
-          send_vecs(input.get(global_worker_id), target_server_id, comm_);
+        for (int p = 0; p < part_num; ++p) {
+          for (int j = 0; j < local_worker_num; ++j) {
+            int global_worker_id =
+                comm_spec_.get_global_worker_id(target_server_id, j);
+            send_vecs(input.get(p * global_worker_num + global_worker_id),
+                      target_server_id, comm_);
+          }
         }
       }
-    });
+    };
 
-    std::thread recv_thread([&, this]() {
+    auto recv = [&, this]() {
       for (int i = 1; i < comm_spec_.server_num(); ++i) {
         int source_server_id = (server_id_ + comm_spec_.server_num() - i) %
                                comm_spec_.server_num();
-        for (int j = 0; j < comm_spec_.local_worker_num(); ++j) {
-          std::vector<char> buf;
-          recv_vecs(buf, source_server_id, comm_);
-          output.put(j, std::move(buf));
+        for (int p = 0; p < part_num; ++p) {
+          for (int j = 0; j < local_worker_num; ++j) {
+            std::vector<char> buf;
+            recv_vecs(buf, source_server_id, comm_);
+            output.put(p * local_worker_num + j, std::move(buf));
+          }
         }
       }
-      for (int j = 0; j < comm_spec_.local_worker_num(); ++j) {
-        int global_worker_id = comm_spec_.get_global_worker_id(server_id_, j);
-        for (auto& vec : input.get(global_worker_id)) {
-          output.put(j, std::move(vec));
+      for (int p = 0; p < part_num; ++p) {
+        for (int j = 0; j < local_worker_num; ++j) {
+          int global_worker_id =
+              comm_spec_.get_global_worker_id(server_id_, j);
+          auto& vecs = input.get(p * global_worker_num + global_worker_id);
+          for (auto& vec : vecs) {
+            output.put(p * local_worker_num + j, std::move(vec));
+          }
         }
       }
-    });
+    };
 
-    recv_thread.join();
-    send_thread.join();
+    threads_.run([&](int tid) {
+      if (tid == 0) {
+        send();
+      } else {
+        recv();
+      }
+    });
 
     return output;
   }
 
+  // Starts a streamed shuffle with producer_num local producers.
+  void stream_begin(int producer_num) {
+    int remote_num = comm_spec_.server_num() - 1;
+    channels_.clear();
+    for (int i = 0; i < comm_spec_.local_worker_num(); ++i) {
+      channels_.emplace_back(
+          std::make_unique<Channel>(producer_num + remote_num));
+    }
+    if (single_server()) {
+      return;
+    }
+    outbox_ = std::make_unique<Outbox>(producer_num);
+    stream_task_ = [this](int tid) {
+      if (tid == 0) {
+        stream_send();
+      } else {
+        stream_recv();
+      }
+    };
+    threads_.start(stream_task_);
+  }
+
+  // Chunks for local worker i, from local and remote producers.
+  Channel& stream_channel(int i) { return *channels_[i]; }
+
+  void send_chunk(int dst, std::vector<char>&& chunk) override {
+    if (comm_spec_.get_server_id(dst) == server_id_) {
+      channels_[comm_spec_.get_local_worker_id(dst)]->push(std::move(chunk));
+    } else {
+      outbox_->push(std::make_pair(dst, std::move(chunk)));
+    }
+  }
+
+  // Called by each local producer after its last chunk.
+  void stream_producer_done() {
+    for (auto& channel : channels_) {
+      channel->close();
+    }
+    if (outbox_ != nullptr) {
+      outbox_->close();
+    }
+  }
+
+  // Waits until every chunk has been sent and received.
+  void stream_end() {
+    if (!single_server()) {
+      threads_.wait();
+    }
+    channels_.clear();
+    outbox_.reset();
+  }
+
  private:
+  void stream_send() {
+    std::pair<int, std::vector<char>> item;
+    while (outbox_->pop(item)) {
+      size_t header[2] = {
+          static_cast<size_t>(comm_spec_.get_local_worker_id(item.first)),
+          item.second.size()};
+      int dst_server_id = comm_spec_.get_server_id(item.first);
+      MPI_Send(header, sizeof(header), MPI_CHAR, dst_server_id, STREAM_TAG,
+               comm_);
+      send_buffer(item.second.data(), item.second.size(), dst_server_id,
+                  comm_, STREAM_TAG);
+    }
+    for (int i = 1; i < comm_spec_.server_num(); ++i) {
+      size_t header[2] = {END_OF_STREAM, 0};
+      MPI_Send(header, sizeof(header), MPI_CHAR,
+               (server_id_ + i) % comm_spec_.server_num(), STREAM_TAG, comm_);
+    }
+  }
+
+  void stream_recv() {
+    int remaining = comm_spec_.server_num() - 1;
+    while (remaining > 0) {
+      size_t header[2];
+      MPI_Status status;
+      MPI_Recv(header, sizeof(header), MPI_CHAR, MPI_ANY_SOURCE, STREAM_TAG,
+               comm_, &status);
+      if (header[0] == END_OF_STREAM) {
+        --remaining;
+        for (auto& channel : channels_) {
+          channel->close();
+        }
+        continue;
+      }
+      std::vector<char> chunk(header[1]);
+      recv_buffer(chunk.data(), chunk.size(), status.MPI_SOURCE, comm_,
+                  STREAM_TAG);
+      channels_[header[0]]->push(std::move(chunk));
+    }
+  }
+
   MPI_Comm comm_;
   int server_id_;
   CommSpec comm_spec_;
+  ThreadGroup& threads_;
+
+  std::vector<std::unique_ptr<Channel>> channels_;
+  std::unique_ptr<Outbox> outbox_;
+  std::function<void(int)> stream_task_;
 };
 
 }  // namespace ladder
@@ -6,12 +6,18 @@
 
 #include "graph/graph_db.h"
 #include "ladder/communicator.h"
+#include "ladder/edge_range_queue.h"
 
 namespace ladder {
 
+// Vertices with more edges than this are expanded in ranges of this size,
+// shared by all local workers, instead of whole by a single worker.
+static constexpr int DEFAULT_SPLIT_THRESHOLD = 1024;
+
 class IContext {
  public:
-  IContext() = default;
+  IContext()
+      : split_threshold_(DEFAULT_SPLIT_THRESHOLD), edge_range_queue_(nullptr) {}
   virtual ~IContext() = default;
 
   void set_comm_spec(int worker_id, int server_id, const CommSpec& comm_spec) {
@@ -30,6 +36,16 @@ class IContext {
   }
   int global_worker_num() const { return comm_spec_.global_worker_num(); }
 
+  // A threshold <= 0 disables splitting.
+  void set_split_threshold(int threshold) { split_threshold_ = threshold; }
+  int split_threshold() const { return split_threshold_; }
+
+  // Set by the runner for the duration of each step.
+  void set_edge_range_queue(EdgeRangeQueue* queue) {
+    edge_range_queue_ = queue;
+  }
+  EdgeRangeQueue* edge_range_queue() const { return edge_range_queue_; }
+
   void clear_params() { params_.clear(); }
   void set_param(const std::string& key, const std::string& value) {
     params_[key] = value;
@@ -42,6 +58,8 @@ class IContext {
   int worker_id_;
   int server_id_;
   CommSpec comm_spec_;
+  int split_threshold_;
+  EdgeRangeQueue* edge_range_queue_;
 
   std::map<std::string, std::string> params_;
 };
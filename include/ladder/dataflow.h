@@ -3,6 +3,7 @@
 
 #include <assert.h>
 
+#include <functional>
 #include <memory>
 #include <queue>
 #include <thread>
@@ -11,6 +12,7 @@
 #include "ladder/communicator.h"
 #include "ladder/context.h"
 #include "ladder/operator.h"
+#include "ladder/thread_group.h"
 
 namespace ladder {
 
@@ -21,16 +23,21 @@ class DataFlow {
   DataFlow() : lvl_(0), sink_op_(-1) {}
   ~DataFlow() = default;
 
-  int add_nullary_operator(std::unique_ptr<INullaryOperator>&& op) {
+  // routing declares where an operator sends its output, see Routing.
+  int add_nullary_operator(std::unique_ptr<INullaryOperator>&& op,
+                           Routing routing = Routing::kHash) {
     operators_.emplace_back(std::move(op));
+    routings_.push_back(routing);
     std::vector<int> cur;
     upstreams_.emplace_back(std::move(cur));
 
     return operators_.size() - 1;
   }
 
-  int add_unary_operator(std::unique_ptr<IUnaryOperator>&& op, int upstream) {
+  int add_unary_operator(std::unique_ptr<IUnaryOperator>&& op, int upstream,
+                         Routing routing = Routing::kHash) {
     operators_.emplace_back(std::move(op));
+    routings_.push_back(routing);
     std::vector<int> cur;
     cur.push_back(upstream);
     upstreams_.emplace_back(std::move(cur));
@@ -39,8 +46,9 @@ class DataFlow {
   }
 
   int add_binary_operator(std::unique_ptr<IBinaryOperator>&& op, int upstream0,
-                          int upstream1) {
+                          int upstream1, Routing routing = Routing::kHash) {
     operators_.emplace_back(std::move(op));
+    routings_.push_back(routing);
     std::vector<int> cur;
     cur.push_back(upstream0);
     cur.push_back(upstream1);
@@ -52,6 +60,8 @@ class DataFlow {
   void sink(int op_id) {
     sink_op_ = op_id;
     generate_order();
+    generate_stages();
+    generate_steps();
   }
 
  private:
@@ -124,11 +134,58 @@ class DataFlow {
     }
   }
 
+  // Fuses chains into stages run in a single step. An operator joins the
+  // stage of its upstream if that is the only input, it is the only reader
+  // of it, and the upstream keeps its output on the producing worker. The
+  // output is then handed over in memory, without a shuffle round.
+  void generate_stages() {
+    stages_.clear();
+    std::vector<int> stage_of(upstreams_.size(), -1);
+    for (auto v : order_) {
+      if (upstreams_[v].size() == 1) {
+        int u = upstreams_[v][0];
+        if (routings_[u] == Routing::kLocal && output_refcount_[u] == 1 &&
+            stages_[stage_of[u]].back() == u) {
+          stage_of[v] = stage_of[u];
+          stages_[stage_of[v]].push_back(v);
+          continue;
+        }
+      }
+      stage_of[v] = stages_.size();
+      stages_.emplace_back(1, v);
+    }
+  }
+
+  // Groups stages that do not depend on each other into steps, by their
+  // distance from the sources. The stages of a step run together and share
+  // one shuffle round.
+  void generate_steps() {
+    std::vector<int> stage_of(upstreams_.size(), -1);
+    std::vector<int> level(stages_.size(), 0);
+    steps_.clear();
+    for (size_t s = 0; s < stages_.size(); ++s) {
+      for (auto u : upstreams_[stages_[s].front()]) {
+        level[s] = std::max(level[s], level[stage_of[u]] + 1);
+      }
+      for (auto v : stages_[s]) {
+        stage_of[v] = s;
+      }
+      if (level[s] >= static_cast<int>(steps_.size())) {
+        steps_.resize(level[s] + 1);
+      }
+      steps_[level[s]].push_back(s);
+    }
+  }
+
   friend class DataFlowRunner;
 
   std::vector<std::unique_ptr<IOperator>> operators_;
   std::vector<std::vector<int>> upstreams_;
+  std::vector<Routing> routings_;
   std::vector<int> order_;
+  std::vector<std::vector<int>> stages_;
+  // Indices of the stages run by each step.
+  std::vector<std::vector<int>> steps_;
   std::vector<int> output_refcount_;
   int sink_op_;
   int lvl_;
@@ -148,6 +205,7 @@ class MessageSlot {
 
   void deref() {
     --ref_count_;
+    CHECK_GE(ref_count_, 0) << "message slot released more often than read";
     if (ref_count_ == 0) {
       messages_.clear();
     }
@@ -162,108 +220,88 @@ class MessageSlot {
 
 class DataFlowRunner {
  public:
+  // Operators run on threads, one thread per local worker.
   DataFlowRunner(const DataFlow& dataflow, std::vector<IContext*>& contexts,
-                 const CommSpec& comm_spec)
+                 const CommSpec& comm_spec, ThreadGroup& threads)
       : dataflow_(dataflow),
         contexts_(contexts),
         comm_spec_(comm_spec),
-        cur_step_(0) {
+        threads_(threads),
+        cur_step_(0),
+        step_span_(1),
+        stream_comm_(nullptr),
+        stream_threads_(nullptr) {
+    CHECK_EQ(threads.thread_num(), comm_spec.local_worker_num());
     slots_.resize(dataflow.operators_.size());
   }
 
+  // Lets a stage stream its output through comm into the next stage, which
+  // then runs at the same time on threads, with its own contexts.
+  void set_streaming(Communicator* comm, ThreadGroup* threads,
+                     const std::vector<IContext*>& contexts) {
+    CHECK_EQ(threads->thread_num(), comm_spec_.local_worker_num());
+    stream_comm_ = comm;
+    stream_threads_ = threads;
+    stream_contexts_ = contexts;
+  }
+
+  // Runs the stages of the current step, or a stage and the next one if it
+  // streams into it. Only the output of the last operator of each stage
+  // leaves the workers, the output of the i-th stage of the step as part i
+  // of the batch, see Communicator::shuffle.
   MessageBatch StepStart() {
     int global_worker_num = comm_spec_.global_worker_num();
-    MessageBatch ret(global_worker_num);
-    if (cur_step_ == dataflow_.order_.size()) {
-      return ret;
+    if (cur_step_ == dataflow_.steps_.size()) {
+      return MessageBatch(global_worker_num);
     }
-    int cur_op = dataflow_.order_[cur_step_];
+    const std::vector<int>& step = dataflow_.steps_[cur_step_];
     std::vector<std::queue<std::pair<int, std::vector<char>>>> message_queues(
         comm_spec_.local_worker_num());
+    std::vector<EdgeRangeQueues> edge_ranges;
+    for (auto s : step) {
+      edge_ranges.emplace_back(
+          create_edge_range_queues(dataflow_.stages_[s].size()));
+    }
 
-    OperatorType op_type = dataflow_.operators_[cur_op]->type();
-    if (op_type == OperatorType::kNullary) {
-      std::vector<std::thread> threads;
-      for (int i = 0; i < comm_spec_.local_worker_num(); ++i) {
-        threads.emplace_back(
-            [&, this](int tid) {
-              std::vector<InStream> output(global_worker_num);
-              dynamic_cast<INullaryOperator*>(
-                  dataflow_.operators_[cur_op].get())
-                  ->Execute(*contexts_[tid], output);
-              for (int i = 0; i < global_worker_num; ++i) {
-                if (output[i].size() != 0) {
-                  message_queues[tid].emplace(i, std::move(output[i].buffer()));
-                }
-              }
-            },
-            i);
-      }
-      for (auto& thrd : threads) {
-        thrd.join();
-      }
-    } else if (op_type == OperatorType::kUnary) {
-      int upstream = dataflow_.upstreams_[cur_op].at(0);
-      std::vector<OutStream> inputs;
-      for (int i = 0; i < comm_spec_.local_worker_num(); ++i) {
-        inputs.emplace_back(slots_[upstream].get(i));
-      }
-
-      std::vector<std::thread> threads;
-      for (int i = 0; i < comm_spec_.local_worker_num(); ++i) {
-        threads.emplace_back(
-            [&, this](int tid) {
-              std::vector<InStream> output(global_worker_num);
-              dynamic_cast<IUnaryOperator*>(dataflow_.operators_[cur_op].get())
-                  ->Execute(*contexts_[tid], inputs[tid], output);
-              for (int i = 0; i < global_worker_num; ++i) {
-                if (output[i].size() != 0) {
-                  message_queues[tid].emplace(i, std::move(output[i].buffer()));
-                }
-              }
-            },
-            i);
-      }
-      for (auto& thrd : threads) {
-        thrd.join();
-      }
-
-      slots_[upstream].deref();
+    if (streamed()) {
+      const std::vector<int>& stage = dataflow_.stages_[step[0]];
+      const std::vector<int>& next =
+          dataflow_.stages_[dataflow_.steps_[cur_step_ + 1][0]];
+      auto next_edge_ranges = create_edge_range_queues(next.size());
+      stream_comm_->stream_begin(comm_spec_.local_worker_num());
+      std::function<void(int)> consume = [&, this](int tid) {
+        OutStream input(stream_comm_->stream_channel(tid));
+        run_stage(next, *stream_contexts_[tid], tid, &input, next_edge_ranges,
+                  nullptr, 0, message_queues[tid]);
+      };
+      stream_threads_->start(consume);
+      threads_.run([&, this](int tid) {
+        run_stage(stage, *contexts_[tid], tid, nullptr, edge_ranges[0],
+                  stream_comm_, 0, message_queues[tid]);
+        stream_comm_->stream_producer_done();
+      });
+      stream_threads_->wait();
+      stream_comm_->stream_end();
+      step_span_ = 2;
     } else {
-      assert(op_type == OperatorType::kBinary);
-      int upstream0 = dataflow_.upstreams_[cur_op].at(0);
-      int upstream1 = dataflow_.upstreams_[cur_op].at(1);
-      std::vector<OutStream> inputs0, inputs1;
-      for (int i = 0; i < comm_spec_.local_worker_num(); ++i) {
-        inputs0.emplace_back(slots_[upstream0].get(i));
-        inputs1.emplace_back(slots_[upstream1].get(i));
-      }
-
-      std::vector<std::thread> threads;
-      for (int i = 0; i < comm_spec_.local_worker_num(); ++i) {
-        threads.emplace_back(
-            [&](int tid) {
-              std::vector<InStream> output(global_worker_num);
-              dynamic_cast<IBinaryOperator*>(dataflow_.operators_[cur_op].get())
-                  ->Execute(*contexts_[tid], inputs0[tid], inputs1[tid],
-                            output);
-              for (int i = 0; i < global_worker_num; ++i) {
-                if (output[i].size() != 0) {
-                  message_queues[tid].emplace(i, std::move(output[i].buffer()));
-                }
-              }
-            },
-            i);
-      }
+      // Workers that finish a stage early move on to the next one.
+      threads_.run([&, this](int tid) {
+        for (size_t i = 0; i < step.size(); ++i) {
+          run_stage(dataflow_.stages_[step[i]], *contexts_[tid], tid, nullptr,
+                    edge_ranges[i], nullptr, i * global_worker_num,
+                    message_queues[tid]);
+        }
+      });
+      step_span_ = 1;
+    }
 
-      for (auto& thrd : threads) {
-        thrd.join();
+    for (auto s : step) {
+      for (int upstream : dataflow_.upstreams_[dataflow_.stages_[s].front()]) {
+        slots_[upstream].deref();
       }
-
-      slots_[upstream0].deref();
-      slots_[upstream1].deref();
     }
 
+    MessageBatch ret(step.size() * global_worker_num);
     for (auto& que : message_queues) {
       while (!que.empty()) {
         auto& top = que.front();
@@ -276,21 +314,189 @@ class DataFlowRunner {
   }
 
   void StepFinish(MessageBatch&& messages) {
-    int cur_op = dataflow_.order_[cur_step_++];
-    slots_[cur_op].init(dataflow_.output_refcount_[cur_op]);
-    slots_[cur_op].ingest(std::move(messages));
+    cur_step_ += step_span_;
+    const std::vector<int>& step = dataflow_.steps_[cur_step_ - 1];
+    int local_worker_num = comm_spec_.local_worker_num();
+    CHECK_EQ(messages.size(), step.size() * local_worker_num);
+    if (step.size() == 1) {
+      int cur_op = dataflow_.stages_[step[0]].back();
+      slots_[cur_op].init(dataflow_.output_refcount_[cur_op]);
+      slots_[cur_op].ingest(std::move(messages));
+      return;
+    }
+    for (size_t i = 0; i < step.size(); ++i) {
+      int cur_op = dataflow_.stages_[step[i]].back();
+      MessageBatch part(local_worker_num);
+      for (int j = 0; j < local_worker_num; ++j) {
+        for (auto& vec : messages.get(i * local_worker_num + j)) {
+          part.put(j, std::move(vec));
+        }
+      }
+      slots_[cur_op].init(dataflow_.output_refcount_[cur_op]);
+      slots_[cur_op].ingest(std::move(part));
+    }
   }
 
-  bool Terminated() const { return cur_step_ == dataflow_.order_.size(); }
+  bool Terminated() const { return cur_step_ == dataflow_.steps_.size(); }
 
   MessageBatch& get_sink() { return slots_[dataflow_.sink_op_].get_batch(); }
 
  private:
+  using EdgeRangeQueues = std::vector<std::unique_ptr<EdgeRangeQueue>>;
+
+  // Operators of a stage run back to back without a barrier, so each gets
+  // its own queue.
+  EdgeRangeQueues create_edge_range_queues(size_t op_num) const {
+    EdgeRangeQueues queues;
+    for (size_t i = 0; i < op_num; ++i) {
+      queues.emplace_back(
+          std::make_unique<EdgeRangeQueue>(comm_spec_.local_worker_num()));
+    }
+    return queues;
+  }
+
+  // Whether the current step and the next one are single stages, and the
+  // first is the only input of the second and can stream into it.
+  bool streamed() const {
+    if (stream_comm_ == nullptr ||
+        cur_step_ + 1 >= dataflow_.steps_.size() ||
+        dataflow_.steps_[cur_step_].size() != 1 ||
+        dataflow_.steps_[cur_step_ + 1].size() != 1) {
+      return false;
+    }
+    int stage = dataflow_.steps_[cur_step_][0];
+    int next = dataflow_.steps_[cur_step_ + 1][0];
+    int producer = dataflow_.stages_[stage].back();
+    const std::vector<int>& upstreams =
+        dataflow_.upstreams_[dataflow_.stages_[next].front()];
+    return dataflow_.output_refcount_[producer] == 1 &&
+           upstreams.size() == 1 && upstreams[0] == producer;
+  }
+
+  // Runs stage on worker tid. The first operator reads input if given. The
+  // output of the last one is queued for the shuffle at offset plus its
+  // destination, after the chunks that were handed to sink while it ran.
+  void run_stage(const std::vector<int>& stage, IContext& context, int tid,
+                 OutStream* input, EdgeRangeQueues& edge_ranges,
+                 ChunkSink* sink, int offset,
+                 std::queue<std::pair<int, std::vector<char>>>& messages) {
+    int global_worker_num = comm_spec_.global_worker_num();
+    int self = context.global_worker_id();
+    std::vector<std::vector<char>> local_input;
+    for (size_t i = 0; i < stage.size(); ++i) {
+      bool last = (i + 1 == stage.size());
+      context.set_edge_range_queue(edge_ranges[i].get());
+      RoutedSink routed_sink(*this, stage[i], self, sink);
+      std::vector<InStream> output(global_worker_num);
+      if (last && sink != nullptr) {
+        for (int j = 0; j < global_worker_num; ++j) {
+          output[j].set_sink(&routed_sink, j);
+        }
+      }
+      if (i == 0) {
+        execute_operator(stage[i], context, tid, input, output);
+      } else {
+        OutStream fused_input(local_input);
+        execute_operator(stage[i], context, tid, &fused_input, output);
+      }
+      check_routing(stage[i], self, output);
+      if (!last) {
+        local_input.clear();
+        local_input.emplace_back(std::move(output[self].buffer()));
+        continue;
+      }
+      for (int j = 0; j < global_worker_num; ++j) {
+        output[j].flush();
+        if (output[j].size() != 0) {
+          messages.emplace(offset + j, std::move(output[j].buffer()));
+        }
+      }
+    }
+    context.set_edge_range_queue(nullptr);
+  }
+
+  // Runs op on worker tid. Unless input is given, inputs are read from the
+  // slots of the upstream operators.
+  void execute_operator(int op, IContext& context, int tid, OutStream* input,
+                        std::vector<InStream>& output) {
+    IOperator* base = dataflow_.operators_[op].get();
+    const std::vector<int>& upstreams = dataflow_.upstreams_[op];
+    OperatorType op_type = base->type();
+    if (op_type == OperatorType::kNullary) {
+      dynamic_cast<INullaryOperator*>(base)->Execute(context, output);
+    } else if (op_type == OperatorType::kUnary) {
+      if (input != nullptr) {
+        dynamic_cast<IUnaryOperator*>(base)->Execute(context, *input, output);
+      } else {
+        OutStream slot_input(slots_[upstreams[0]].get(tid));
+        dynamic_cast<IUnaryOperator*>(base)->Execute(context, slot_input,
+                                                     output);
+      }
+    } else {
+      assert(op_type == OperatorType::kBinary);
+      OutStream input0(slots_[upstreams[0]].get(tid));
+      OutStream input1(slots_[upstreams[1]].get(tid));
+      dynamic_cast<IBinaryOperator*>(base)->Execute(context, input0, input1,
+                                                    output);
+    }
+  }
+
+  // Output an operator sends elsewhere than its routing declares would be
+  // lost in a fused stage.
+  void check_destination(int op, int self, int dst) const {
+    Routing routing = dataflow_.routings_[op];
+    if (routing == Routing::kHash) {
+      return;
+    }
+    int target = routing == Routing::kLocal ? self : 0;
+    if (dst != target) {
+      LOG(FATAL) << "operator " << op << " sends to worker " << dst
+                 << " against its routing";
+    }
+  }
+
+  // Checks the output an operator still holds once it returns.
+  void check_routing(int op, int self,
+                     const std::vector<InStream>& output) const {
+    for (size_t i = 0; i < output.size(); ++i) {
+      if (output[i].size() != 0) {
+        check_destination(op, self, i);
+      }
+    }
+  }
+
+  // Checks the chunks a streamed operator flushes while it runs, before they
+  // leave the worker.
+  class RoutedSink : public ChunkSink {
+   public:
+    RoutedSink(const DataFlowRunner& runner, int op, int self,
+               ChunkSink* sink)
+        : runner_(runner), op_(op), self_(self), sink_(sink) {}
+
+    void send_chunk(int dst, std::vector<char>&& chunk) override {
+      runner_.check_destination(op_, self_, dst);
+      sink_->send_chunk(dst, std::move(chunk));
+    }
+
+   private:
+    const DataFlowRunner& runner_;
+    int op_;
+    int self_;
+    ChunkSink* sink_;
+  };
+
   const DataFlow& dataflow_;
   std::vector<IContext*>& contexts_;
   std::vector<MessageSlot> slots_;
   CommSpec comm_spec_;
+  ThreadGroup& threads_;
   size_t cur_step_;
+  // Steps run by the current StepStart.
+  size_t step_span_;
+
+  Communicator* stream_comm_;
+  ThreadGroup* stream_threads_;
+  std::vector<IContext*> stream_contexts_;
 };
 
 }  // namespace ladder
@@ -0,0 +1,75 @@
+#ifndef LADDER_LADDER_EDGE_RANGE_QUEUE_H_
+#define LADDER_LADDER_EDGE_RANGE_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "graph/types.h"
+
+namespace ladder {
+
+// A slice [begin, end) of the adjacency list of vertex. key is carried along
+// with every neighbor of the slice, and tag tells the operator which
+// adjacency the slice belongs to.
+struct EdgeRange {
+  gid_t key;
+  vertex_t vertex;
+  int tag;
+  int begin;
+  int end;
+};
+
+// Shared by the local workers of one step to spread the edges of high-degree
+// vertices. Every worker pushes the ranges of the hubs it owns, calls
+// finish_push() exactly once, and then pops ranges until none is left. Pops
+// only start after all workers have pushed, so the queue is read-only by
+// then and is consumed with a single atomic cursor.
+class EdgeRangeQueue {
+ public:
+  explicit EdgeRangeQueue(int worker_num)
+      : pushing_worker_num_(worker_num), cursor_(0) {}
+  ~EdgeRangeQueue() = default;
+
+  // Splits the first degree edges of vertex into ranges of range_size.
+  void push(gid_t key, vertex_t vertex, int tag, int degree, int range_size) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (int begin = 0; begin < degree; begin += range_size) {
+      ranges_.push_back(
+          {key, vertex, tag, begin, std::min(begin + range_size, degree)});
+    }
+  }
+
+  // Blocks until every local worker has finished pushing.
+  void finish_push() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (--pushing_worker_num_ == 0) {
+      cv_.notify_all();
+    } else {
+      cv_.wait(lock, [this]() { return pushing_worker_num_ == 0; });
+    }
+  }
+
+  bool pop(EdgeRange& range) {
+    size_t idx = cursor_.fetch_add(1, std::memory_order_relaxed);
+    if (idx >= ranges_.size()) {
+      return false;
+    }
+    range = ranges_[idx];
+    return true;
+  }
+
+ private:
+  std::vector<EdgeRange> ranges_;
+  int pushing_worker_num_;
+  std::atomic<size_t> cursor_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
+}  // namespace ladder
+
+#endif  // LADDER_LADDER_EDGE_RANGE_QUEUE_H_
@@ -3,11 +3,16 @@
 
 #include <vector>
 
+#include "ladder/channel.h"
+
 namespace ladder {
 
 class InStream {
  public:
-  InStream() = default;
+  // Bytes buffered before emit() hands a chunk to the sink.
+  static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+  InStream() : sink_(nullptr), dst_(0) {}
   ~InStream() = default;
 
   size_t size() const { return buffer_.size(); }
@@ -16,11 +21,35 @@ class InStream {
     buffer_.insert(buffer_.end(), data, data + size);
   }
 
+  // Writes one record. With a sink, full chunks are sent while the operator
+  // is still running; records written with << are sent by flush() only.
+  template <typename... FIELDS_T>
+  void emit(const FIELDS_T&... fields) {
+    ((*this) << ... << fields);
+    if (sink_ != nullptr && buffer_.size() >= CHUNK_SIZE) {
+      flush();
+    }
+  }
+
+  void set_sink(ChunkSink* sink, int dst) {
+    sink_ = sink;
+    dst_ = dst;
+  }
+
+  void flush() {
+    if (sink_ != nullptr && !buffer_.empty()) {
+      sink_->send_chunk(dst_, std::move(buffer_));
+      buffer_.clear();
+    }
+  }
+
   std::vector<char>& buffer() { return buffer_; }
   const std::vector<char>& buffer() const { return buffer_; }
 
  private:
   std::vector<char> buffer_;
+  ChunkSink* sink_;
+  int dst_;
 };
 
 template <typename T>
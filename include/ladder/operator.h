@@ -12,6 +12,15 @@ enum class OperatorType {
   kBinary,
 };
 
+// Where an operator sends its output. kLocal writes only to the worker it
+// runs on and kGather only to global worker 0; kHash may write anywhere.
+// Local operators can be fused with their downstream, see DataFlow.
+enum class Routing {
+  kHash,
+  kLocal,
+  kGather,
+};
+
 class IOperator {
  public:
   virtual ~IOperator() = default;
@@ -7,19 +7,36 @@
 #include <string_view>
 #include <vector>
 
+#include "ladder/channel.h"
+
 namespace ladder {
 
 class OutStream {
  public:
   OutStream(const std::vector<std::vector<char>>& buffers)
-      : buffers_(buffers), idx_(0), offset_(0) {
+      : buffers_(buffers), channel_(nullptr), idx_(0), offset_(0) {
     while (idx_ < buffers_.size() && buffers_[idx_].empty()) {
       idx_ += 1;
     }
   }
+  // Reads chunks as they arrive on channel. Chunks are kept until the stream
+  // is destroyed, as slices taken from them may still be in use.
+  explicit OutStream(Channel& channel)
+      : buffers_(received_), channel_(&channel), idx_(0), offset_(0) {}
   ~OutStream() = default;
 
-  bool empty() const { return (idx_ == buffers_.size()); }
+  // Blocks for the next chunk when reading from a channel.
+  bool empty() {
+    while (idx_ == buffers_.size() && channel_ != nullptr) {
+      std::vector<char> chunk;
+      if (!channel_->pop(chunk)) {
+        channel_ = nullptr;
+      } else if (!chunk.empty()) {
+        received_.emplace_back(std::move(chunk));
+      }
+    }
+    return (idx_ == buffers_.size());
+  }
 
   size_t Read(char* data, size_t size) {
     CHECK_LT(idx_, buffers_.size());
@@ -48,7 +65,9 @@ class OutStream {
   }
 
  private:
+  std::vector<std::vector<char>> received_;
   const std::vector<std::vector<char>>& buffers_;
+  Channel* channel_;
   size_t idx_;
   size_t offset_;
 };
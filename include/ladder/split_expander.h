@@ -0,0 +1,115 @@
+#ifndef LADDER_LADDER_SPLIT_EXPANDER_H_
+#define LADDER_LADDER_SPLIT_EXPANDER_H_
+
+#include <limits>
+#include <vector>
+
+#include "graph/graph_view.h"
+#include "ladder/context.h"
+#include "ladder/edge_range_queue.h"
+
+namespace ladder {
+
+// Expands source vertices over one or more adjacencies of the same view type,
+// and spreads the edges of high-degree vertices over all local workers. The
+// position of a view in views is the tag of its ranges in the EdgeRangeQueue
+// of the step.
+//
+// Every local worker reads the same sources. expand() handles the vertices
+// the worker owns, vertex % local worker num, and queues those with more than
+// split_threshold edges in a view as ranges. Every local worker must then call
+// finish() once, which hands the queued ranges to whichever worker pops them.
+// With a threshold <= 0, each worker expands its part of every list instead,
+// see expand_partial, and finish() does nothing.
+template <typename VIEW_T>
+class SplitExpander {
+  // Vertex of a source that was not found, see VertexMap::get_internal_ids.
+  static constexpr vertex_t INVALID_VERTEX =
+      std::numeric_limits<vertex_t>::max();
+
+ public:
+  SplitExpander(const IContext& context, std::vector<const VIEW_T*> views)
+      : views_(std::move(views)),
+        worker_id_(context.local_worker_id()),
+        worker_num_(context.local_worker_num()),
+        split_threshold_(context.split_threshold()),
+        edge_ranges_(context.edge_range_queue()) {}
+  ~SplitExpander() = default;
+
+  // Calls func(keys[i], neighbor) for the edges of vertices[i], i < num, that
+  // are expanded by this worker now. Invalid vertices have no edges.
+  template <typename FUNC_T>
+  void expand(const gid_t* keys, const vertex_t* vertices, size_t num,
+              const FUNC_T& func) {
+    if (split_threshold_ <= 0) {
+      for (auto view : views_) {
+        edges_.clear();
+        view->expand_partial(vertices, num, worker_id_, worker_num_, edges_);
+        emit_expanded(keys, func);
+      }
+      return;
+    }
+    for (size_t tag = 0; tag < views_.size(); ++tag) {
+      batch_keys_.clear();
+      batch_.clear();
+      for (size_t i = 0; i < num; ++i) {
+        vertex_t vertex = vertices[i];
+        if (vertex == INVALID_VERTEX ||
+            vertex % worker_num_ != static_cast<vertex_t>(worker_id_)) {
+          continue;
+        }
+        int degree = views_[tag]->degree(vertex);
+        if (degree > split_threshold_) {
+          edge_ranges_->push(keys[i], vertex, tag, degree, split_threshold_);
+        } else {
+          batch_keys_.push_back(keys[i]);
+          batch_.push_back(vertex);
+        }
+      }
+      edges_.clear();
+      views_[tag]->expand(batch_.data(), batch_.size(), edges_);
+      emit_expanded(batch_keys_.data(), func);
+    }
+  }
+
+  // Calls func(key, neighbor) for the edges of the ranges this worker pops.
+  // Blocks until every local worker has called finish().
+  template <typename FUNC_T>
+  void finish(const FUNC_T& func) {
+    if (split_threshold_ <= 0) {
+      return;
+    }
+    edge_ranges_->finish_push();
+    EdgeRange range;
+    while (edge_ranges_->pop(range)) {
+      for (auto nbr : views_[range.tag]
+                          ->get_edges(range.vertex)
+                          .slice(range.begin, range.end)) {
+        func(range.key, nbr);
+      }
+    }
+  }
+
+ private:
+  // keys[e.src_idx] is the key of an expanded edge e.
+  template <typename FUNC_T>
+  void emit_expanded(const gid_t* keys, const FUNC_T& func) const {
+    for (auto& e : edges_) {
+      func(keys[e.src_idx], e.neighbor);
+    }
+  }
+
+  std::vector<const VIEW_T*> views_;
+  int worker_id_;
+  int worker_num_;
+  int split_threshold_;
+  EdgeRangeQueue* edge_ranges_;
+
+  std::vector<gid_t> batch_keys_;
+  std::vector<vertex_t> batch_;
+  std::vector<ExpandedEdge> edges_;
+};
+
+}  // namespace ladder
+
+#endif  // LADDER_LADDER_SPLIT_EXPANDER_H_
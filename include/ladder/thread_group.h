@@ -0,0 +1,127 @@
+#ifndef LADDER_LADDER_THREAD_GROUP_H
+#define LADDER_LADDER_THREAD_GROUP_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ladder/topology.h"
+
+namespace ladder {
+
+// Long-lived threads that run one task together, each with its own thread
+// id, and then wait for the next. Unlike ThreadPool, a task is a single step
+// that every thread takes part in, so run() is a fork-join without creating
+// threads.
+class ThreadGroup {
+  // Iterations run() polls for the last thread before it blocks. Steps of
+  // short queries usually finish within it.
+  static constexpr int SPIN_NUM = 1 << 12;
+
+ public:
+  explicit ThreadGroup(int thread_num)
+      : generation_(0), remaining_(0), stopped_(false) {
+    if (thread_num < 1) {
+      thread_num = 1;
+    }
+    for (int i = 0; i < thread_num; ++i) {
+      threads_.emplace_back([this](int tid) { loop(tid); }, i);
+    }
+  }
+
+  ~ThreadGroup() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto& thrd : threads_) {
+      thrd.join();
+    }
+  }
+
+  ThreadGroup(const ThreadGroup&) = delete;
+  ThreadGroup& operator=(const ThreadGroup&) = delete;
+
+  int thread_num() const { return threads_.size(); }
+
+  // Calls task(tid) on every thread and returns when all calls returned.
+  // Not reentrant.
+  void run(const std::function<void(int)>& task) {
+    start(task);
+    wait();
+  }
+
+  // Like run(), but returns at once. task must outlive the matching wait().
+  void start(const std::function<void(int)>& task) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_ = &task;
+      remaining_.store(threads_.size(), std::memory_order_relaxed);
+      ++generation_;
+    }
+    task_cv_.notify_all();
+  }
+
+  void wait() {
+    for (int i = 0; i < SPIN_NUM; ++i) {
+      if (remaining_.load(std::memory_order_acquire) == 0) {
+        return;
+      }
+      std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() {
+      return remaining_.load(std::memory_order_acquire) == 0;
+    });
+  }
+
+  // Thread i runs on cpus[i], wrapping around. Memory a thread touches first
+  // is then placed on its own NUMA node. Empty cpus leaves threads unpinned.
+  void pin(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+      return;
+    }
+    run([&cpus](int tid) { pin_thread({cpus[tid % cpus.size()]}); });
+  }
+
+ private:
+  void loop(int tid) {
+    size_t seen = 0;
+    while (true) {
+      const std::function<void(int)>* task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        task_cv_.wait(lock,
+                      [&, this]() { return stopped_ || generation_ != seen; });
+        if (stopped_) {
+          return;
+        }
+        seen = generation_;
+        task = task_;
+      }
+      (*task)(tid);
+      if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.notify_all();
+      }
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  const std::function<void(int)>* task_ = nullptr;
+  size_t generation_;
+  std::atomic<size_t> remaining_;
+  bool stopped_;
+
+  std::mutex mutex_;
+  std::condition_variable task_cv_;
+  std::condition_variable done_cv_;
+};
+
+}  // namespace ladder
+
+#endif  // LADDER_LADDER_THREAD_GROUP_H
@@ -0,0 +1,193 @@
+#ifndef LADDER_LADDER_TOPOLOGY_H
+#define LADDER_LADDER_TOPOLOGY_H
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.h"
+
+namespace ladder {
+
+// How local workers are placed on cores: not at all, filling one NUMA node
+// before the next, or round-robin across nodes.
+enum class PinPolicy {
+  kNone,
+  kCompact,
+  kScatter,
+};
+
+// Memory policy modes of set_mempolicy(2), so that libnuma is not needed.
+static constexpr int MEMORY_POLICY_DEFAULT = 0;
+static constexpr int MEMORY_POLICY_INTERLEAVE = 3;
+
+// NUMA nodes and their cpus, as listed in /sys and restricted to the cpus
+// this process may run on. Without /sys, all cpus form a single node.
+class Topology {
+  static constexpr int MAX_NODE_NUM = 64;
+
+ public:
+  Topology() { detect(); }
+  ~Topology() = default;
+
+  int node_num() const { return nodes_.size(); }
+
+  const std::vector<int>& node_cpus(int node) const { return nodes_[node]; }
+
+  // Bit i is set if node i has usable cpus.
+  unsigned long node_mask() const { return node_mask_; }
+
+  // One cpu per thread. Threads outnumbering cpus wrap around.
+  std::vector<int> assign_cpus(int thread_num, PinPolicy policy) const {
+    std::vector<int> cpus;
+    if (policy == PinPolicy::kNone) {
+      return cpus;
+    }
+    std::vector<int> ordered;
+    if (policy == PinPolicy::kCompact) {
+      for (auto& node : nodes_) {
+        ordered.insert(ordered.end(), node.begin(), node.end());
+      }
+    } else {
+      for (size_t i = 0; ordered.size() < cpu_num(); ++i) {
+        for (auto& node : nodes_) {
+          if (i < node.size()) {
+            ordered.push_back(node[i]);
+          }
+        }
+      }
+    }
+    for (int i = 0; i < thread_num; ++i) {
+      cpus.push_back(ordered[i % ordered.size()]);
+    }
+    return cpus;
+  }
+
+  // Cpus not in used, or the first node if all are used.
+  std::vector<int> spare_cpus(const std::vector<int>& used) const {
+    std::set<int> used_set(used.begin(), used.end());
+    std::vector<int> spare;
+    for (auto& node : nodes_) {
+      for (int cpu : node) {
+        if (used_set.count(cpu) == 0) {
+          spare.push_back(cpu);
+        }
+      }
+    }
+    return spare.empty() ? nodes_[0] : spare;
+  }
+
+ private:
+  size_t cpu_num() const {
+    size_t num = 0;
+    for (auto& node : nodes_) {
+      num += node.size();
+    }
+    return num;
+  }
+
+  // Parses lists like "0-3,8-11".
+  static std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+      size_t end = list.find(',', pos);
+      if (end == std::string::npos) {
+        end = list.size();
+      }
+      std::string range = list.substr(pos, end - pos);
+      size_t dash = range.find('-');
+      if (!range.empty()) {
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos
+                       ? first
+                       : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+          cpus.push_back(cpu);
+        }
+      }
+      pos = end + 1;
+    }
+    return cpus;
+  }
+
+  void detect() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool restricted = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    auto usable = [&](int cpu) {
+      return !restricted || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed));
+    };
+
+    for (int node = 0; node < MAX_NODE_NUM; ++node) {
+      std::string fname = "/sys/devices/system/node/node" +
+                          std::to_string(node) + "/cpulist";
+      if (!file_exists(fname)) {
+        continue;
+      }
+      std::ifstream file(fname);
+      std::string list;
+      std::getline(file, list);
+      std::vector<int> cpus;
+      for (int cpu : parse_cpu_list(list)) {
+        if (usable(cpu)) {
+          cpus.push_back(cpu);
+        }
+      }
+      if (!cpus.empty()) {
+        nodes_.emplace_back(std::move(cpus));
+        node_mask_ |= 1UL << node;
+      }
+    }
+    if (nodes_.empty()) {
+      std::vector<int> cpus;
+      int cpu_num = std::thread::hardware_concurrency();
+      for (int cpu = 0; cpu < std::max(cpu_num, 1); ++cpu) {
+        if (usable(cpu)) {
+          cpus.push_back(cpu);
+        }
+      }
+      nodes_.emplace_back(cpus.empty() ? std::vector<int>{0} : cpus);
+      node_mask_ = 1;
+    }
+  }
+
+  std::vector<std::vector<int>> nodes_;
+  unsigned long node_mask_ = 0;
+};
+
+// Restricts the calling thread to cpus. No-op if cpus is empty.
+inline bool pin_thread(const std::vector<int>& cpus) {
+  if (cpus.empty()) {
+    return true;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+// Pages first touched by the calling thread, and by threads it creates
+// afterwards, are interleaved across the nodes in node_mask until
+// reset_memory_policy() is called.
+inline bool set_interleave_policy(unsigned long node_mask) {
+  return syscall(SYS_set_mempolicy, MEMORY_POLICY_INTERLEAVE, &node_mask,
+                 sizeof(node_mask) * 8) == 0;
+}
+
+inline bool reset_memory_policy() {
+  return syscall(SYS_set_mempolicy, MEMORY_POLICY_DEFAULT, nullptr, 0) == 0;
+}
+
+}  // namespace ladder
+
+#endif  // LADDER_LADDER_TOPOLOGY_H
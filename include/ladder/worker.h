@@ -2,41 +2,74 @@
 #define LADDER_LADDER_WORKER_H
 
 #include <map>
+#include <memory>
 #include <string>
 
 #include "graph/graph_db.h"
 #include "ladder/app.h"
 #include "ladder/communicator.h"
 #include "ladder/dataflow.h"
+#include "ladder/thread_group.h"
+#include "ladder/topology.h"
 
 namespace ladder {
 
 class Worker {
  public:
   Worker(int worker_num, int server_id, int server_num)
-      : server_id_(server_id) {
+      : server_id_(server_id),
+        split_threshold_(DEFAULT_SPLIT_THRESHOLD),
+        worker_threads_(worker_num),
+        comm_threads_(2) {
     comm_spec_.init(worker_num, server_num);
   }
 
   ~Worker() = default;
 
+  void set_split_threshold(int threshold) { split_threshold_ = threshold; }
+
+  // Pins local workers to cores, and the communication threads to the cores
+  // left over.
+  void set_pin_policy(PinPolicy policy) {
+    if (policy != PinPolicy::kNone) {
+      Topology topology;
+      worker_cpus_ =
+          topology.assign_cpus(comm_spec_.local_worker_num(), policy);
+      std::vector<int> comm_cpus = topology.spare_cpus(worker_cpus_);
+      worker_threads_.pin(worker_cpus_);
+      comm_threads_.run([&comm_cpus](int) { pin_thread(comm_cpus); });
+      if (stream_threads_ != nullptr) {
+        stream_threads_->pin(worker_cpus_);
+      }
+    }
+  }
+
+  // Streams the output of a stage into the next one while it is produced,
+  // see DataFlowRunner::set_streaming. Consumers get threads of their own,
+  // sharing the cores of the local workers.
+  void set_streaming(bool streaming) {
+    if (!streaming) {
+      stream_threads_.reset();
+    } else if (stream_threads_ == nullptr) {
+      stream_threads_ =
+          std::make_unique<ThreadGroup>(comm_spec_.local_worker_num());
+      stream_threads_->pin(worker_cpus_);
+    }
+  }
+
   void Eval(const GraphDB& graph, const App& app,
             const std::map<std::string, std::string>& params) {
     DataFlow* dataflow = app.create_dataflow();
-    std::vector<IContext*> contexts;
-    for (int i = 0; i < comm_spec_.local_worker_num(); ++i) {
-      IContext* ctx = app.create_context(&graph);
-      ctx->set_comm_spec(i, server_id_, comm_spec_);
-      ctx->clear_params();
-      for (auto& pair : params) {
-        ctx->set_param(pair.first, pair.second);
-      }
-      contexts.push_back(ctx);
+    std::vector<IContext*> contexts = create_contexts(graph, app, params);
+
+    Communicator comm(server_id_, comm_spec_, comm_threads_);
+    DataFlowRunner runner(*dataflow, contexts, comm_spec_, worker_threads_);
+    std::vector<IContext*> stream_contexts;
+    if (stream_threads_ != nullptr) {
+      stream_contexts = create_contexts(graph, app, params);
+      runner.set_streaming(&comm, stream_threads_.get(), stream_contexts);
     }
 
-    Communicator comm(server_id_, comm_spec_);
-    DataFlowRunner runner(*dataflow, contexts, comm_spec_);
-
     int round = 0;
     while (!runner.Terminated()) {
       ++round;
@@ -57,28 +90,27 @@ class Worker {
         }
       }
     }
+    delete_contexts(contexts);
+    delete_contexts(stream_contexts);
   }
 
   void EvalBatch(
       const GraphDB& graph, const App& app,
       const std::vector<std::map<std::string, std::string>>& params) {
     DataFlow* dataflow = app.create_dataflow();
-    Communicator comm(server_id_, comm_spec_);
+    Communicator comm(server_id_, comm_spec_, comm_threads_);
 
     for (auto& param : params) {
-      std::vector<IContext*> contexts;
-      for (int i = 0; i < comm_spec_.local_worker_num(); ++i) {
-        IContext* ctx = app.create_context(&graph);
-        ctx->set_comm_spec(i, server_id_, comm_spec_);
-        ctx->clear_params();
-        for (auto& pair : param) {
-          ctx->set_param(pair.first, pair.second);
-        }
-        contexts.push_back(ctx);
+      std::vector<IContext*> contexts = create_contexts(graph, app, param);
+
+      DataFlowRunner runner(*dataflow, contexts, comm_spec_,
+                            worker_threads_);
+      std::vector<IContext*> stream_contexts;
+      if (stream_threads_ != nullptr) {
+        stream_contexts = create_contexts(graph, app, param);
+        runner.set_streaming(&comm, stream_threads_.get(), stream_contexts);
       }
 
-      DataFlowRunner runner(*dataflow, contexts, comm_spec_);
-
       int round = 0;
       while (!runner.Terminated()) {
         ++round;
@@ -99,12 +131,44 @@ class Worker {
           }
         }
       }
+      delete_contexts(contexts);
+      delete_contexts(stream_contexts);
     }
   }
 
  private:
+  std::vector<IContext*> create_contexts(
+      const GraphDB& graph, const App& app,
+      const std::map<std::string, std::string>& params) const {
+    std::vector<IContext*> contexts;
+    for (int i = 0; i < comm_spec_.local_worker_num(); ++i) {
+      IContext* ctx = app.create_context(&graph);
+      ctx->set_comm_spec(i, server_id_, comm_spec_);
+      ctx->set_split_threshold(split_threshold_);
+      ctx->clear_params();
+      for (auto& pair : params) {
+        ctx->set_param(pair.first, pair.second);
+      }
+      contexts.push_back(ctx);
+    }
+    return contexts;
+  }
+
+  // Once the runner has finished with them.
+  static void delete_contexts(std::vector<IContext*>& contexts) {
+    for (auto ctx : contexts) {
+      delete ctx;
+    }
+    contexts.clear();
+  }
+
   int server_id_;
   CommSpec comm_spec_;
+  int split_threshold_;
+  ThreadGroup worker_threads_;
+  ThreadGroup comm_threads_;
+  std::unique_ptr<ThreadGroup> stream_threads_;
+  std::vector<int> worker_cpus_;
 };
 
 }  // namespace ladder
@@ -0,0 +1,129 @@
+#ifndef LADDER_MMAP_ARRAY_H_
+#define LADDER_MMAP_ARRAY_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "utils.h"
+
+namespace ladder {
+
+enum class StorageStrategy {
+  kMemory,
+  kMmap,
+};
+
+// Read-only array backed either by a heap buffer or by a shared, read-only
+// mapping of a binary file. Mapped pages live in the page cache, so processes
+// on the same host opening the same partition share one copy.
+template <typename T>
+class MmapArray {
+ public:
+  MmapArray() : data_(nullptr), size_(0), mapped_(nullptr), mapped_size_(0) {}
+  ~MmapArray() { reset(); }
+
+  MmapArray(const MmapArray&) = delete;
+  MmapArray& operator=(const MmapArray&) = delete;
+
+  MmapArray(MmapArray&& rhs) noexcept : MmapArray() { swap(rhs); }
+  MmapArray& operator=(MmapArray&& rhs) noexcept {
+    reset();
+    swap(rhs);
+    return *this;
+  }
+
+  void open(const std::string& fname, StorageStrategy strategy) {
+    reset();
+    if (strategy == StorageStrategy::kMemory) {
+      load_from_file(fname, buffer_);
+      data_ = buffer_.data();
+      size_ = buffer_.size();
+      return;
+    }
+
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd == -1) {
+      std::cerr << "Error: cannot open file " << fname << std::endl;
+      return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+      std::cerr << "Error: cannot stat file " << fname << std::endl;
+      ::close(fd);
+      return;
+    }
+    size_t file_size = st.st_size;
+    if (file_size != 0) {
+      void* addr = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (addr == MAP_FAILED) {
+        std::cerr << "Error: cannot mmap file " << fname << ": "
+                  << strerror(errno) << std::endl;
+      } else {
+        mapped_ = addr;
+        mapped_size_ = file_size;
+        data_ = static_cast<const T*>(addr);
+        size_ = file_size / sizeof(T);
+      }
+    }
+    ::close(fd);
+  }
+
+  // Takes ownership of an array built in memory.
+  void assign(std::vector<T>&& vec) {
+    reset();
+    buffer_ = std::move(vec);
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+  }
+
+  void reset() {
+    if (mapped_ != nullptr) {
+      munmap(mapped_, mapped_size_);
+      mapped_ = nullptr;
+      mapped_size_ = 0;
+    }
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  void swap(MmapArray& rhs) {
+    std::swap(data_, rhs.data_);
+    std::swap(size_, rhs.size_);
+    std::swap(mapped_, rhs.mapped_);
+    std::swap(mapped_size_, rhs.mapped_size_);
+    buffer_.swap(rhs.buffer_);
+  }
+
+  bool is_mapped() const { return mapped_ != nullptr; }
+
+  inline size_t size() const { return size_; }
+  inline bool empty() const { return size_ == 0; }
+  inline const T* data() const { return data_; }
+
+  inline const T& operator[](size_t idx) const { return data_[idx]; }
+
+  inline const T* begin() const { return data_; }
+  inline const T* end() const { return data_ + size_; }
+
+ private:
+  const T* data_;
+  size_t size_;
+
+  void* mapped_;
+  size_t mapped_size_;
+  std::vector<T> buffer_;
+};
+
+}  // namespace ladder
+
+#endif  // LADDER_MMAP_ARRAY_H_
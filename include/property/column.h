@@ -1,12 +1,21 @@
 #ifndef LADDER_PROPERTY_COLUMN_H
 #define LADDER_PROPERTY_COLUMN_H
 
+#include <algorithm>
+#include <cstdio>
+#include <limits>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
+#include "glog/logging.h"
 #include "property/date.h"
 #include "property/datetime.h"
+#include "mmap_array.h"
+#include "property/encoding.h"
+#include "property/select.h"
 #include "property/types.h"
 #include "utils.h"
 
@@ -16,75 +25,703 @@ class IColumn {
  public:
   virtual ~IColumn() = default;
 
-  virtual void open(const std::string& prefix) = 0;
+  virtual void open(const std::string& prefix,
+                    StorageStrategy strategy) = 0;
   virtual size_t size() = 0;
 };
 
+// Order-preserving integer key of a value, used by zone maps and sorted
+// indices.
+template <typename T>
+inline int64_t column_key(T value) {
+  return static_cast<int64_t>(value);
+}
+inline int64_t column_key(Date value) { return value.to_i32(); }
+inline int64_t column_key(DateTime value) { return value.to_i64(); }
+
+// Plain type a column value is stored as, used by the scan kernels.
+template <typename T>
+struct column_raw {
+  using type = T;
+  static T get(T value) { return value; }
+};
+template <>
+struct column_raw<Date> {
+  using type = int32_t;
+  static int32_t get(Date value) { return value.to_i32(); }
+};
+template <>
+struct column_raw<DateTime> {
+  using type = int64_t;
+  static int64_t get(DateTime value) { return value.to_i64(); }
+};
+
 template <typename T>
 class NumericColumn : public IColumn {
  public:
-  NumericColumn() = default;
+  // Rows summarized by one zone map entry.
+  static constexpr size_t ZONE_SHIFT = 12;
+  static constexpr size_t ZONE_SIZE = 1ULL << ZONE_SHIFT;
+
+  NumericColumn()
+      : encoding_(ColumnEncoding::kPlain),
+        row_num_(0),
+        base_(0),
+        zone_map_(false),
+        sorted_index_(false) {}
   ~NumericColumn() = default;
 
-  void open(const std::string& prefix) override {
-    load_from_file(prefix, data_);
+  // Reads the encoding declared in "<prefix>_meta" if any, see
+  // property/encoding.h, and the plain array otherwise.
+  void open(const std::string& prefix, StorageStrategy strategy) override {
+    encoding_ = ColumnEncoding::kPlain;
+    if constexpr (std::is_integral<raw_type>::value) {
+      std::string meta_fname = prefix + "_meta";
+      if (file_exists(meta_fname)) {
+        open_encoded(prefix, meta_fname, strategy);
+      }
+    }
+    if (encoding_ == ColumnEncoding::kPlain) {
+      data_.open(prefix, strategy);
+      row_num_ = data_.size();
+    }
+  }
+
+  inline size_t size() override { return row_num_; }
+
+  ColumnEncoding encoding() const { return encoding_; }
+
+  inline T get(size_t idx) const {
+    if (encoding_ == ColumnEncoding::kPlain) {
+      return data_[idx];
+    }
+    return static_cast<T>(get_raw(idx));
+  }
+
+  // out[i] = get(rows[i]).
+  void gather(const size_t* rows, size_t num, T* out) const {
+    switch (encoding_) {
+    case ColumnEncoding::kFor:
+      for (size_t i = 0; i < num; ++i) {
+        out[i] = static_cast<T>(
+            static_cast<raw_type>(base_ + packed_.get(rows[i])));
+      }
+      break;
+    case ColumnEncoding::kDict:
+      for (size_t i = 0; i < num; ++i) {
+        out[i] = static_cast<T>(dict_[packed_.get(rows[i])]);
+      }
+      break;
+    case ColumnEncoding::kRle: {
+      // Rows are mostly ascending, so each one starts from the run of the
+      // previous one.
+      size_t run = 0;
+      for (size_t i = 0; i < num; ++i) {
+        run = find_run_from(rows[i], run);
+        out[i] = static_cast<T>(run_values_[run]);
+      }
+      break;
+    }
+    default:
+      ladder::gather(data_.data(), rows, num, out);
+    }
+  }
+
+  // Full-column scans, appending matching rows to a selection vector, see
+  // property/select.h. Encoded columns are matched on runs, on dictionary
+  // codes or on decoded blocks.
+  void select_equal(T value, std::vector<size_t>& rows) const {
+    if (encoding_ == ColumnEncoding::kPlain) {
+      ladder::select_equal(raw_data(), row_num_, raw::get(value), rows);
+    } else {
+      select_between(value, value, rows);
+    }
+  }
+
+  void select_less(T value, std::vector<size_t>& rows) const {
+    if (encoding_ == ColumnEncoding::kPlain) {
+      ladder::select_less(raw_data(), row_num_, raw::get(value), rows);
+    } else if (raw::get(value) != std::numeric_limits<raw_type>::min()) {
+      select_encoded(std::numeric_limits<raw_type>::min(),
+                     raw::get(value) - 1, rows);
+    }
+  }
+
+  // Rows within [low, high].
+  void select_between(T low, T high, std::vector<size_t>& rows) const {
+    if (encoding_ == ColumnEncoding::kPlain) {
+      ladder::select_between(raw_data(), row_num_, raw::get(low),
+                             raw::get(high), rows);
+    } else {
+      select_encoded(raw::get(low), raw::get(high), rows);
+    }
+  }
+
+  // Appends the rows of input whose values satisfy pred to rows, gathering
+  // values a block at a time. Conjunctions are chains of refine calls.
+  template <typename PRED_T>
+  void refine(const std::vector<size_t>& input, const PRED_T& pred,
+              std::vector<size_t>& rows) const {
+    static constexpr size_t BLOCK = 256;
+    T values[BLOCK];
+    for (size_t i = 0; i < input.size(); i += BLOCK) {
+      size_t block = std::min(BLOCK, input.size() - i);
+      gather(input.data() + i, block, values);
+      for (size_t j = 0; j < block; ++j) {
+        if (pred(values[j])) {
+          rows.push_back(input[i + j]);
+        }
+      }
+    }
+  }
+
+  // Loads the per-zone min/max keys persisted next to the column, or
+  // computes them.
+  void open_zone_map(const std::string& prefix, StorageStrategy strategy) {
+    size_t zone_num = (row_num_ + ZONE_SIZE - 1) >> ZONE_SHIFT;
+    if (file_exists(prefix + "_zone_min") &&
+        file_exists(prefix + "_zone_max")) {
+      zone_min_.open(prefix + "_zone_min", strategy);
+      zone_max_.open(prefix + "_zone_max", strategy);
+      if (zone_min_.size() == zone_num && zone_max_.size() == zone_num) {
+        zone_map_ = true;
+        return;
+      }
+      std::cerr << "Warning: stale zone map " << prefix << ", rebuilding"
+                << std::endl;
+    }
+    std::vector<int64_t> zone_min(zone_num), zone_max(zone_num);
+    for (size_t z = 0; z < zone_num; ++z) {
+      size_t begin = z << ZONE_SHIFT;
+      size_t end = std::min(begin + ZONE_SIZE, row_num_);
+      int64_t min_key = column_key(get(begin)), max_key = min_key;
+      for (size_t i = begin + 1; i < end; ++i) {
+        int64_t key = column_key(get(i));
+        min_key = std::min(min_key, key);
+        max_key = std::max(max_key, key);
+      }
+      zone_min[z] = min_key;
+      zone_max[z] = max_key;
+    }
+    zone_min_.assign(std::move(zone_min));
+    zone_max_.assign(std::move(zone_max));
+    zone_map_ = true;
+  }
+
+  bool dump_zone_map(const std::string& prefix) const {
+    return zone_map_ &&
+           dump_to_file(prefix + "_zone_min", zone_min_.data(),
+                        zone_min_.size()) &&
+           dump_to_file(prefix + "_zone_max", zone_max_.data(),
+                        zone_max_.size());
+  }
+
+  bool has_zone_map() const { return zone_map_; }
+
+  // Appends the maximal row ranges [first, second) whose keys lie in
+  // [low, high]. With a zone map, zones outside the window are skipped and
+  // zones inside it are taken whole, so only boundary zones are read.
+  void range_scan(int64_t low, int64_t high,
+                  std::vector<std::pair<size_t, size_t>>& ranges) const {
+    auto append = [&ranges](size_t begin, size_t end) {
+      if (!ranges.empty() && ranges.back().second == begin) {
+        ranges.back().second = end;
+      } else {
+        ranges.emplace_back(begin, end);
+      }
+    };
+    auto scan = [&](size_t begin, size_t end) {
+      size_t run = begin;
+      for (size_t i = begin; i < end; ++i) {
+        int64_t key = column_key(get(i));
+        if (key < low || key > high) {
+          if (run < i) {
+            append(run, i);
+          }
+          run = i + 1;
+        }
+      }
+      if (run < end) {
+        append(run, end);
+      }
+    };
+    if (!zone_map_) {
+      scan(0, row_num_);
+      return;
+    }
+    for (size_t z = 0; z < zone_min_.size(); ++z) {
+      if (zone_max_[z] < low || zone_min_[z] > high) {
+        continue;
+      }
+      size_t begin = z << ZONE_SHIFT;
+      size_t end = std::min(begin + ZONE_SIZE, row_num_);
+      if (zone_min_[z] >= low && zone_max_[z] <= high) {
+        append(begin, end);
+      } else {
+        scan(begin, end);
+      }
+    }
+  }
+
+  // Like range_scan, as a bitmap with one bit per row.
+  void range_select(int64_t low, int64_t high,
+                    std::vector<uint64_t>& bitmap) const {
+    std::vector<std::pair<size_t, size_t>> ranges;
+    range_scan(low, high, ranges);
+    bitmap.assign((row_num_ + 63) / 64, 0);
+    for (auto& range : ranges) {
+      for (size_t i = range.first; i < range.second; ++i) {
+        bitmap[i >> 6] |= 1ULL << (i & 63);
+      }
+    }
+  }
+
+  // Loads the permutation of rows sorted by key persisted next to the
+  // column, or computes it.
+  void open_sorted_index(const std::string& prefix,
+                         StorageStrategy strategy) {
+    if (file_exists(prefix + "_sorted")) {
+      sorted_rows_.open(prefix + "_sorted", strategy);
+      if (sorted_rows_.size() == row_num_) {
+        sorted_index_ = true;
+        return;
+      }
+      std::cerr << "Warning: stale sorted index " << prefix
+                << ", rebuilding" << std::endl;
+    }
+    std::vector<size_t> sorted_rows(row_num_);
+    for (size_t i = 0; i < sorted_rows.size(); ++i) {
+      sorted_rows[i] = i;
+    }
+    std::stable_sort(sorted_rows.begin(), sorted_rows.end(),
+                     [this](size_t a, size_t b) {
+                       return column_key(get(a)) < column_key(get(b));
+                     });
+    sorted_rows_.assign(std::move(sorted_rows));
+    sorted_index_ = true;
+  }
+
+  bool dump_sorted_index(const std::string& prefix) const {
+    return sorted_index_ && dump_to_file(prefix + "_sorted",
+                                         sorted_rows_.data(),
+                                         sorted_rows_.size());
   }
 
-  inline size_t size() override { return data_.size(); }
+  bool has_sorted_index() const { return sorted_index_; }
 
-  inline T get(size_t idx) const { return data_[idx]; }
+  // The rows whose keys lie in [low, high], in key order, as a slice of the
+  // sorted index. Only valid with a sorted index.
+  std::pair<const size_t*, const size_t*> sorted_range(int64_t low,
+                                                       int64_t high) const {
+    const size_t* begin = sorted_rows_.data();
+    const size_t* end = begin + sorted_rows_.size();
+    const size_t* first = std::lower_bound(
+        begin, end, low, [this](size_t row, int64_t key) {
+          return column_key(get(row)) < key;
+        });
+    const size_t* last = std::upper_bound(
+        first, end, high, [this](int64_t key, size_t row) {
+          return key < column_key(get(row));
+        });
+    return std::make_pair(first, last);
+  }
 
  private:
-  std::vector<T> data_;
+  using raw = column_raw<T>;
+  static_assert(sizeof(typename raw::type) == sizeof(T),
+                "column values must be stored as their raw type");
+
+  using raw_type = typename raw::type;
+
+  // Only valid for plain columns.
+  const raw_type* raw_data() const {
+    return reinterpret_cast<const raw_type*>(data_.data());
+  }
+
+  void open_encoded(const std::string& prefix, const std::string& meta_fname,
+                    StorageStrategy strategy) {
+    std::vector<size_t> meta;
+    load_from_file(meta_fname, meta);
+    CHECK_EQ(meta.size(), 4) << "Invalid column meta " << meta_fname;
+    encoding_ = static_cast<ColumnEncoding>(meta[0]);
+    row_num_ = meta[1];
+    switch (encoding_) {
+    case ColumnEncoding::kFor:
+      packed_.open(prefix + "_packed", meta[2], strategy);
+      base_ = meta[3];
+      break;
+    case ColumnEncoding::kRle:
+      run_values_.open(prefix + "_run_values", strategy);
+      run_ends_.open(prefix + "_run_ends", strategy);
+      CHECK_EQ(run_values_.size(), meta[2]);
+      break;
+    case ColumnEncoding::kDict:
+      dict_.open(prefix + "_dict", strategy);
+      packed_.open(prefix + "_packed", meta[3], strategy);
+      CHECK_EQ(dict_.size(), meta[2]);
+      break;
+    case ColumnEncoding::kPlain:
+      break;
+    default:
+      LOG(FATAL) << "Unknown encoding " << meta[0] << " in " << meta_fname;
+    }
+  }
+
+  // Index of the run holding row idx.
+  inline size_t find_run(size_t idx) const {
+    return std::upper_bound(run_ends_.begin(), run_ends_.end(), idx) -
+           run_ends_.begin();
+  }
+
+  // Like find_run, trying the run hint and the one after it first.
+  inline size_t find_run_from(size_t idx, size_t hint) const {
+    if (idx < (hint == 0 ? 0 : run_ends_[hint - 1])) {
+      return find_run(idx);
+    }
+    if (idx < run_ends_[hint]) {
+      return hint;
+    }
+    if (hint + 1 < run_ends_.size() && idx < run_ends_[hint + 1]) {
+      return hint + 1;
+    }
+    return std::upper_bound(run_ends_.begin() + hint + 1, run_ends_.end(),
+                            idx) -
+           run_ends_.begin();
+  }
+
+  inline raw_type get_raw(size_t idx) const {
+    switch (encoding_) {
+    case ColumnEncoding::kFor:
+      return static_cast<raw_type>(base_ + packed_.get(idx));
+    case ColumnEncoding::kRle:
+      return run_values_[find_run(idx)];
+    case ColumnEncoding::kDict:
+      return dict_[packed_.get(idx)];
+    default:
+      return raw_data()[idx];
+    }
+  }
+
+  // Rows of an encoded column within [low, high]. Runs are matched whole,
+  // dictionary columns compare codes against the code range of the window,
+  // and frame-of-reference columns are decoded a block at a time.
+  void select_encoded(raw_type low, raw_type high,
+                      std::vector<size_t>& rows) const {
+    if (high < low) {
+      return;
+    }
+    if (encoding_ == ColumnEncoding::kRle) {
+      for (size_t r = 0; r < run_values_.size(); ++r) {
+        if (!(run_values_[r] < low) && !(high < run_values_[r])) {
+          for (size_t i = (r == 0 ? 0 : run_ends_[r - 1]); i < run_ends_[r];
+               ++i) {
+            rows.push_back(i);
+          }
+        }
+      }
+    } else if (encoding_ == ColumnEncoding::kDict) {
+      int64_t first =
+          std::lower_bound(dict_.begin(), dict_.end(), low) - dict_.begin();
+      int64_t last =
+          std::upper_bound(dict_.begin(), dict_.end(), high) - dict_.begin();
+      if (first < last) {
+        select_blocks<int64_t>(
+            [this](size_t i) { return static_cast<int64_t>(packed_.get(i)); },
+            first, last - 1, rows);
+      }
+    } else {
+      select_blocks<raw_type>(
+          [this](size_t i) {
+            return static_cast<raw_type>(base_ + packed_.get(i));
+          },
+          low, high, rows);
+    }
+  }
+
+  template <typename V, typename DECODE_T>
+  void select_blocks(const DECODE_T& decode, V low, V high,
+                     std::vector<size_t>& rows) const {
+    static constexpr size_t BLOCK = 1024;
+    V values[BLOCK];
+    std::vector<size_t> block_rows;
+    for (size_t begin = 0; begin < row_num_; begin += BLOCK) {
+      size_t block = std::min(BLOCK, row_num_ - begin);
+      for (size_t i = 0; i < block; ++i) {
+        values[i] = decode(begin + i);
+      }
+      block_rows.clear();
+      ladder::select_between(values, block, low, high, block_rows);
+      for (size_t row : block_rows) {
+        rows.push_back(begin + row);
+      }
+    }
+  }
+
+  ColumnEncoding encoding_;
+  size_t row_num_;
+  MmapArray<T> data_;
+  BitPackedArray packed_;
+  uint64_t base_;
+  MmapArray<raw_type> run_values_;
+  MmapArray<size_t> run_ends_;
+  MmapArray<raw_type> dict_;
+
+  bool zone_map_;
+  MmapArray<int64_t> zone_min_;
+  MmapArray<int64_t> zone_max_;
+
+  bool sorted_index_;
+  MmapArray<size_t> sorted_rows_;
 };
 
 class StringColumn : public IColumn {
  public:
-  StringColumn() = default;
+  static constexpr uint32_t NO_CODE = std::numeric_limits<uint32_t>::max();
+
+  StringColumn() : row_num_(0), dictionary_(false) {}
   ~StringColumn() = default;
 
-  void open(const std::string& prefix) override {
+  // Maps the 32-bit offsets encode_columns wrote if they are current, else
+  // compacts the plain layout in memory.
+  void open(const std::string& prefix, StorageStrategy strategy) override {
+    std::string content_fname = prefix + "_content";
+    content_.open(content_fname, strategy);
+    if (load_narrow_offsets(prefix, strategy)) {
+      return;
+    }
+
     std::string offsets_fname = prefix + "_offset";
-    load_from_file(offsets_fname, offsets_);
+    offsets_.open(offsets_fname, strategy);
 
     std::string lengths_fname = prefix + "_length";
-    load_from_file(lengths_fname, lengths_);
+    lengths_.open(lengths_fname, strategy);
 
-    std::string content_fname = prefix + "_content";
-    load_from_file(content_fname, content_);
+    row_num_ = offsets_.size();
+    compact();
+  }
+
+  // Writes the n + 1 32-bit offsets of the column at prefix as
+  // "<prefix>_noffset", after repacking "_content" and "_offset" if rows are
+  // not stored back to back. Columns with more than 4GB of content are left
+  // as they are.
+  static bool dump_narrow_offsets(const std::string& prefix) {
+    std::vector<size_t> offsets;
+    std::vector<uint16_t> lengths;
+    std::vector<char> content, packed;
+    load_from_file(prefix + "_offset", offsets);
+    load_from_file(prefix + "_length", lengths);
+    load_from_file(prefix + "_content", content);
+    std::vector<uint32_t> narrow_offsets;
+    std::remove((prefix + "_noffset_meta").c_str());
+    if (!narrow_layout(offsets, lengths, content, offsets.size(),
+                       narrow_offsets, packed)) {
+      return true;
+    }
+    if (!packed.empty()) {
+      for (size_t i = 0; i < offsets.size(); ++i) {
+        offsets[i] = narrow_offsets[i];
+      }
+      if (!replace_file(prefix + "_content", packed.data(), packed.size()) ||
+          !replace_file(prefix + "_offset", offsets.data(), offsets.size())) {
+        return false;
+      }
+    }
+    std::vector<size_t> meta = make_narrow_meta(prefix, offsets.size());
+    return replace_file(prefix + "_noffset", narrow_offsets.data(),
+                        narrow_offsets.size()) &&
+           replace_file(prefix + "_noffset_meta", meta.data(), meta.size());
   }
 
-  inline size_t size() override { return offsets_.size(); }
+  inline size_t size() override { return row_num_; }
 
   inline std::string_view get(size_t idx) const {
-    CHECK_LT(idx, offsets_.size());
+    CHECK_LT(idx, row_num_);
+    if (!narrow_offsets_.empty()) {
+      uint32_t begin = narrow_offsets_[idx];
+      return std::string_view(content_.data() + begin,
+                              narrow_offsets_[idx + 1] - begin);
+    }
     CHECK_LT(offsets_[idx], content_.size());
     CHECK_LT(idx, lengths_.size());
     return std::string_view(&content_[offsets_[idx]], lengths_[idx]);
   }
 
+  // Assigns every distinct value a dense code, so that equality filters
+  // compare integers instead of strings.
+  void build_dictionary() {
+    std::vector<uint32_t> codes(row_num_);
+    dictionary_table_.clear();
+    for (size_t i = 0; i < row_num_; ++i) {
+      auto ret = dictionary_table_.emplace(
+          get(i), static_cast<uint32_t>(dictionary_table_.size()));
+      codes[i] = ret.first->second;
+    }
+    codes_.assign(std::move(codes));
+    dictionary_ = true;
+  }
+
+  bool has_dictionary() const { return dictionary_; }
+
+  // Only valid with a dictionary.
+  inline uint32_t get_code(size_t idx) const { return codes_[idx]; }
+
+  // NO_CODE if no row holds value. Only valid with a dictionary.
+  uint32_t lookup_code(std::string_view value) const {
+    auto iter = dictionary_table_.find(value);
+    return iter == dictionary_table_.end() ? NO_CODE : iter->second;
+  }
+
+  // Appends the rows equal to value to rows and returns their number. The
+  // literal is resolved once, and rows are then matched by code if the
+  // column has a dictionary.
+  size_t select_equal(std::string_view value,
+                      std::vector<size_t>& rows) const {
+    size_t old_size = rows.size();
+    if (dictionary_) {
+      uint32_t code = lookup_code(value);
+      if (code == NO_CODE) {
+        return 0;
+      }
+      for (size_t i = 0; i < row_num_; ++i) {
+        if (codes_[i] == code) {
+          rows.push_back(i);
+        }
+      }
+    } else {
+      for (size_t i = 0; i < row_num_; ++i) {
+        if (get(i) == value) {
+          rows.push_back(i);
+        }
+      }
+    }
+    return rows.size() - old_size;
+  }
+
  private:
-  std::vector<size_t> offsets_;
-  std::vector<uint16_t> lengths_;
-  std::vector<char> content_;
+  // The offsets are tied to the row number, and to the size and
+  // modification time of the plain offsets and content they were built from.
+  static std::vector<size_t> make_narrow_meta(const std::string& prefix,
+                                              size_t row_num) {
+    std::string offsets_fname = prefix + "_offset";
+    std::string content_fname = prefix + "_content";
+    return {row_num,
+            get_file_size(offsets_fname),
+            get_file_mtime(offsets_fname),
+            get_file_size(content_fname),
+            get_file_mtime(content_fname)};
+  }
+
+  bool load_narrow_offsets(const std::string& prefix,
+                           StorageStrategy strategy) {
+    std::string meta_fname = prefix + "_noffset_meta";
+    if (!file_exists(meta_fname)) {
+      return false;
+    }
+    std::vector<size_t> meta;
+    load_from_file(meta_fname, meta);
+    if (meta.empty() || meta != make_narrow_meta(prefix, meta[0])) {
+      std::cerr << "Warning: stale offsets " << prefix << "_noffset"
+                << std::endl;
+      return false;
+    }
+    narrow_offsets_.open(prefix + "_noffset", strategy);
+    if (narrow_offsets_.size() != meta[0] + 1) {
+      narrow_offsets_.reset();
+      return false;
+    }
+    row_num_ = meta[0];
+    return true;
+  }
+
+  // Computes n + 1 32-bit offsets, lengths being the distance to the next
+  // one. Rows that are not stored back to back are repacked into packed,
+  // which is left empty otherwise. Returns false if the content is larger
+  // than 4GB.
+  template <typename OFFSETS_T, typename LENGTHS_T, typename CONTENT_T>
+  static bool narrow_layout(const OFFSETS_T& offsets,
+                            const LENGTHS_T& lengths,
+                            const CONTENT_T& content, size_t row_num,
+                            std::vector<uint32_t>& narrow_offsets,
+                            std::vector<char>& packed) {
+    size_t total = 0;
+    bool contiguous = true;
+    for (size_t i = 0; i < row_num; ++i) {
+      contiguous = contiguous && offsets[i] == total;
+      total += lengths[i];
+    }
+    if (total > std::numeric_limits<uint32_t>::max() ||
+        lengths.size() < row_num) {
+      return false;
+    }
+    narrow_offsets.resize(row_num + 1);
+    if (contiguous && total <= content.size()) {
+      for (size_t i = 0; i < row_num; ++i) {
+        narrow_offsets[i] = offsets[i];
+      }
+    } else {
+      packed.resize(total);
+      size_t offset = 0;
+      for (size_t i = 0; i < row_num; ++i) {
+        CHECK_LE(offsets[i] + lengths[i], content.size());
+        std::copy(&content[offsets[i]], &content[offsets[i]] + lengths[i],
+                  packed.data() + offset);
+        narrow_offsets[i] = offset;
+        offset += lengths[i];
+      }
+    }
+    narrow_offsets[row_num] = total;
+    return true;
+  }
+
+  // Replaces the 64-bit offsets and 16-bit lengths with the layout of
+  // narrow_layout in memory. Content larger than 4GB keeps the original
+  // layout.
+  void compact() {
+    std::vector<uint32_t> narrow_offsets;
+    std::vector<char> packed;
+    if (!narrow_layout(offsets_, lengths_, content_, row_num_,
+                       narrow_offsets, packed)) {
+      return;
+    }
+    if (!packed.empty()) {
+      content_.assign(std::move(packed));
+    }
+    narrow_offsets_.assign(std::move(narrow_offsets));
+    offsets_.reset();
+    lengths_.reset();
+  }
+
+  size_t row_num_;
+  MmapArray<size_t> offsets_;
+  MmapArray<uint16_t> lengths_;
+  MmapArray<char> content_;
+  MmapArray<uint32_t> narrow_offsets_;
+
+  bool dictionary_;
+  MmapArray<uint32_t> codes_;
+  std::unordered_map<std::string_view, uint32_t> dictionary_table_;
 };
 
+// Low-cardinality strings: each row holds a 16-bit code into a table of
+// distinct values. Predicates and grouping are meant to work on codes and
+// only resolve strings for output.
 class LCStringColumn : public IColumn {
  public:
-  LCStringColumn() = default;
+  static constexpr uint32_t NO_CODE = StringColumn::NO_CODE;
+
+  LCStringColumn() : code_num_(0) {}
   ~LCStringColumn() = default;
 
-  void open(const std::string& prefix) override {
+  void open(const std::string& prefix, StorageStrategy strategy) override {
     std::string index_fname = prefix + "_index";
-    load_from_file(index_fname, index_);
+    index_.open(index_fname, strategy);
 
-    data_.open(prefix + "_data");
+    data_.open(prefix + "_data", strategy);
 
-    size_t data_size = data_.size();
+    code_num_ = data_.size();
     table_.clear();
-    for (size_t i = 0; i < data_size; ++i) {
-      std::string key = std::string(data_.get(i));
-      table_[key] = static_cast<uint16_t>(i);
+    for (size_t i = 0; i < code_num_; ++i) {
+      table_[data_.get(i)] = static_cast<uint16_t>(i);
     }
   }
 
@@ -95,10 +732,58 @@ class LCStringColumn : public IColumn {
     return data_.get(offset);
   }
 
+  inline uint16_t get_code(size_t idx) const { return index_[idx]; }
+
+  // NO_CODE if no row holds value.
+  uint32_t lookup_code(std::string_view value) const {
+    auto iter = table_.find(value);
+    return iter == table_.end() ? NO_CODE : iter->second;
+  }
+
+  size_t code_num() const { return code_num_; }
+
+  std::string_view get_by_code(uint16_t code) const { return data_.get(code); }
+
+  // Appends the rows with the given code to rows.
+  void select_code(uint16_t code, std::vector<size_t>& rows) const {
+    ladder::select_equal(index_.data(), index_.size(), code, rows);
+  }
+
+  // Appends the rows equal to value to rows and returns their number.
+  size_t select_equal(std::string_view value,
+                      std::vector<size_t>& rows) const {
+    uint32_t code = lookup_code(value);
+    if (code == NO_CODE) {
+      return 0;
+    }
+    size_t old_size = rows.size();
+    select_code(code, rows);
+    return rows.size() - old_size;
+  }
+
+  // Number of rows per code, counts is resized to code_num().
+  void count_by_code(std::vector<size_t>& counts) const {
+    counts.assign(code_num_, 0);
+    for (size_t i = 0; i < index_.size(); ++i) {
+      ++counts[index_[i]];
+    }
+  }
+
+  // Number of the given rows per code, counts is resized to code_num().
+  void count_by_code(const std::vector<size_t>& rows,
+                     std::vector<size_t>& counts) const {
+    counts.assign(code_num_, 0);
+    for (size_t row : rows) {
+      ++counts[index_[row]];
+    }
+  }
+
  private:
-  std::vector<uint16_t> index_;
+  MmapArray<uint16_t> index_;
   StringColumn data_;
-  std::unordered_map<std::string, uint16_t> table_;
+  size_t code_num_;
+  // Keys point into data_.
+  std::unordered_map<std::string_view, uint16_t> table_;
 };
 
 IColumn* create_column(DataType dt) {
@@ -9,7 +9,7 @@ struct DateTime {
  public:
   DateTime() : value_(0) {}
   DateTime(int64_t value) : value_(value) {}
-  int to_i64() const { return value_; }
+  int64_t to_i64() const { return value_; }
 
  private:
   int64_t value_;
@@ -0,0 +1,245 @@
+#ifndef LADDER_PROPERTY_ENCODING_H
+#define LADDER_PROPERTY_ENCODING_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "mmap_array.h"
+#include "utils.h"
+
+namespace ladder {
+
+// Lightweight encodings of integer columns. An encoded column is declared by
+// a "<prefix>_meta" file holding {encoding, row_num, param0, param1}; without
+// it the column is read as a plain array.
+//
+//   kFor:  value = base + packed[i], param0 = width, param1 = base.
+//   kRle:  runs of equal values, value[r] holds rows [end[r - 1], end[r]),
+//          param0 = run number.
+//   kDict: value = dict[packed[i]] over the sorted distinct values,
+//          param0 = dictionary size, param1 = width.
+enum class ColumnEncoding : size_t {
+  kPlain = 0,
+  kFor = 1,
+  kRle = 2,
+  kDict = 3,
+};
+
+inline const char* encoding_name(ColumnEncoding encoding) {
+  switch (encoding) {
+  case ColumnEncoding::kFor:
+    return "for";
+  case ColumnEncoding::kRle:
+    return "rle";
+  case ColumnEncoding::kDict:
+    return "dict";
+  default:
+    return "plain";
+  }
+}
+
+// Bits needed to store value.
+inline size_t bit_width(uint64_t value) {
+  return value == 0 ? 0 : 64 - __builtin_clzll(value);
+}
+
+// Fixed-width unsigned integers packed LSB first into 64-bit words. One
+// spare word is kept at the end, so that a value straddling two words can
+// always be read with two loads.
+class BitPackedArray {
+ public:
+  BitPackedArray() : width_(0), mask_(0) {}
+  ~BitPackedArray() = default;
+
+  static std::vector<uint64_t> pack(const std::vector<uint64_t>& values,
+                                    size_t width) {
+    std::vector<uint64_t> words((values.size() * width + 63) / 64 + 1, 0);
+    for (size_t i = 0; i < values.size() && width != 0; ++i) {
+      size_t bit = i * width;
+      size_t shift = bit & 63;
+      words[bit >> 6] |= values[i] << shift;
+      if (shift + width > 64) {
+        words[(bit >> 6) + 1] |= values[i] >> (64 - shift);
+      }
+    }
+    return words;
+  }
+
+  void open(const std::string& fname, size_t width,
+            StorageStrategy strategy) {
+    words_.open(fname, strategy);
+    set_width(width);
+  }
+
+  inline uint64_t get(size_t idx) const {
+    if (width_ == 0) {
+      return 0;
+    }
+    size_t bit = idx * width_;
+    size_t shift = bit & 63;
+    uint64_t value = words_[bit >> 6] >> shift;
+    if (shift + width_ > 64) {
+      value |= words_[(bit >> 6) + 1] << (64 - shift);
+    }
+    return value & mask_;
+  }
+
+  // out[i] = get(begin + i), for i in [0, num).
+  void decode(size_t begin, size_t num, uint64_t* out) const {
+    for (size_t i = 0; i < num; ++i) {
+      out[i] = get(begin + i);
+    }
+  }
+
+  size_t memory_usage() const { return words_.size() * sizeof(uint64_t); }
+
+ private:
+  void set_width(size_t width) {
+    width_ = width;
+    mask_ = width >= 64 ? ~0ULL : (1ULL << width) - 1;
+  }
+
+  MmapArray<uint64_t> words_;
+  size_t width_;
+  uint64_t mask_;
+};
+
+// Chooses the smallest encoding of a column and writes it next to the plain
+// file at prefix. Only meant for integer raw types, see column_raw.
+template <typename RAW_T>
+class ColumnEncoder {
+  static constexpr size_t MAX_DICT_SIZE = 1 << 16;
+  // Random access to a run-length column searches the run ends, so choose()
+  // only picks it when runs average at least this many rows.
+  static constexpr size_t MIN_RLE_RUN = 16;
+
+ public:
+  explicit ColumnEncoder(const std::vector<RAW_T>& values) : values_(values) {
+    if (values_.empty()) {
+      return;
+    }
+    base_ = *std::min_element(values_.begin(), values_.end());
+    RAW_T max = *std::max_element(values_.begin(), values_.end());
+    for_width_ = bit_width(delta(max, base_));
+    run_num_ = 1;
+    for (size_t i = 1; i < values_.size(); ++i) {
+      run_num_ += (values_[i] != values_[i - 1]);
+    }
+    dict_ = values_;
+    std::sort(dict_.begin(), dict_.end());
+    dict_.erase(std::unique(dict_.begin(), dict_.end()), dict_.end());
+  }
+
+  // Encoded size in bytes, or SIZE_MAX if the encoding does not apply.
+  size_t encoded_size(ColumnEncoding encoding) const {
+    size_t n = values_.size();
+    switch (encoding) {
+    case ColumnEncoding::kFor:
+      return packed_size(n, for_width_);
+    case ColumnEncoding::kRle:
+      return run_num_ * (sizeof(RAW_T) + sizeof(size_t));
+    case ColumnEncoding::kDict:
+      if (dict_.size() > MAX_DICT_SIZE) {
+        return std::numeric_limits<size_t>::max();
+      }
+      return dict_.size() * sizeof(RAW_T) + packed_size(n, dict_width());
+    default:
+      return n * sizeof(RAW_T);
+    }
+  }
+
+  ColumnEncoding choose() const {
+    ColumnEncoding best = ColumnEncoding::kPlain;
+    if (values_.empty()) {
+      return best;
+    }
+    for (ColumnEncoding encoding :
+         {ColumnEncoding::kFor, ColumnEncoding::kRle, ColumnEncoding::kDict}) {
+      if (encoding == ColumnEncoding::kRle &&
+          run_num_ * MIN_RLE_RUN > values_.size()) {
+        continue;
+      }
+      if (encoded_size(encoding) < encoded_size(best)) {
+        best = encoding;
+      }
+    }
+    return best;
+  }
+
+  bool dump(const std::string& prefix, ColumnEncoding encoding) const {
+    size_t n = values_.size();
+    std::vector<size_t> meta = {static_cast<size_t>(encoding), n, 0, 0};
+    bool ok = true;
+    if (encoding == ColumnEncoding::kFor) {
+      std::vector<uint64_t> deltas(n);
+      for (size_t i = 0; i < n; ++i) {
+        deltas[i] = delta(values_[i], base_);
+      }
+      ok = dump_packed(prefix, deltas, for_width_);
+      meta[2] = for_width_;
+      meta[3] = static_cast<size_t>(base_);
+    } else if (encoding == ColumnEncoding::kRle) {
+      std::vector<RAW_T> run_values;
+      std::vector<size_t> run_ends;
+      for (size_t i = 0; i < n; ++i) {
+        if (i == 0 || values_[i] != values_[i - 1]) {
+          if (i != 0) {
+            run_ends.push_back(i);
+          }
+          run_values.push_back(values_[i]);
+        }
+      }
+      if (n != 0) {
+        run_ends.push_back(n);
+      }
+      ok = dump_to_file(prefix + "_run_values", run_values.data(),
+                        run_values.size()) &&
+           dump_to_file(prefix + "_run_ends", run_ends.data(),
+                        run_ends.size());
+      meta[2] = run_values.size();
+    } else if (encoding == ColumnEncoding::kDict) {
+      std::vector<uint64_t> codes(n);
+      for (size_t i = 0; i < n; ++i) {
+        codes[i] = std::lower_bound(dict_.begin(), dict_.end(), values_[i]) -
+                   dict_.begin();
+      }
+      ok = dump_to_file(prefix + "_dict", dict_.data(), dict_.size()) &&
+           dump_packed(prefix, codes, dict_width());
+      meta[2] = dict_.size();
+      meta[3] = dict_width();
+    }
+    return ok && dump_to_file(prefix + "_meta", meta.data(), meta.size());
+  }
+
+ private:
+  static uint64_t delta(RAW_T value, RAW_T base) {
+    return static_cast<uint64_t>(value) - static_cast<uint64_t>(base);
+  }
+
+  static size_t packed_size(size_t n, size_t width) {
+    return ((n * width + 63) / 64 + 1) * sizeof(uint64_t);
+  }
+
+  size_t dict_width() const {
+    return dict_.empty() ? 0 : bit_width(dict_.size() - 1);
+  }
+
+  static bool dump_packed(const std::string& prefix,
+                          const std::vector<uint64_t>& values, size_t width) {
+    std::vector<uint64_t> words = BitPackedArray::pack(values, width);
+    return dump_to_file(prefix + "_packed", words.data(), words.size());
+  }
+
+  const std::vector<RAW_T>& values_;
+  RAW_T base_ = 0;
+  size_t for_width_ = 0;
+  size_t run_num_ = 0;
+  std::vector<RAW_T> dict_;
+};
+
+}  // namespace ladder
+
+#endif  // LADDER_PROPERTY_ENCODING_H
@@ -0,0 +1,280 @@
+#ifndef LADDER_PROPERTY_PROPERTY_INDEX_H
+#define LADDER_PROPERTY_PROPERTY_INDEX_H
+
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mmap_array.h"
+#include "property/column.h"
+#include "property/types.h"
+#include "utils.h"
+
+namespace ladder {
+
+// Both hashes are stable across builds, so that persisted indices stay valid.
+inline size_t hash_string(std::string_view str) {
+  size_t hash = 0xcbf29ce484222325ULL;
+  for (char c : str) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+inline size_t hash_int64(int64_t value) {
+  uint64_t x = static_cast<uint64_t>(value);
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// Secondary index from property values to the rows holding them. Like
+// Indexer, it is an open-addressing table probed linearly, so it can be
+// persisted and mapped. The table holds one slot per distinct value, which
+// points to the ascending rows of that value, so repeated values do not form
+// long probe runs. Keys are compared against the column itself, at the first
+// row of each value. Float columns are not supported.
+class PropertyIndex {
+  static constexpr double MAX_LOAD_FACTOR = 0.5;
+  static constexpr size_t INVALID_VALUE = std::numeric_limits<size_t>::max();
+
+ public:
+  PropertyIndex(const IColumn* column, DataType type)
+      : column_(column), type_(type), row_num_(0), mask_(0) {}
+  ~PropertyIndex() = default;
+
+  void open(const std::string& prefix, size_t row_num,
+            StorageStrategy strategy) {
+    if (!load(prefix, row_num, strategy)) {
+      build(row_num);
+    }
+  }
+
+  bool dump(const std::string& prefix) const {
+    std::vector<size_t> meta = {row_num_, table_.size(), value_num(),
+                                INDEX_VERSION};
+    return dump_to_file(prefix + "_pindex", table_.data(), table_.size()) &&
+           dump_to_file(prefix + "_pindex_offsets", value_offsets_.data(),
+                        value_offsets_.size()) &&
+           dump_to_file(prefix + "_pindex_rows", rows_.data(), rows_.size()) &&
+           dump_to_file(prefix + "_pindex_meta", meta.data(), meta.size());
+  }
+
+  // Appends the rows holding value to rows. Returns false, and appends
+  // nothing, unless the column holds strings.
+  bool lookup(std::string_view value, std::vector<size_t>& rows) const {
+    if (!is_string()) {
+      return false;
+    }
+    for (size_t b = hash_string(value) & mask_; table_[b] != INVALID_VALUE;
+         b = (b + 1) & mask_) {
+      if (get_string(first_row(table_[b])) == value) {
+        append_rows(table_[b], rows);
+        break;
+      }
+    }
+    return true;
+  }
+
+  // Appends the rows holding value to rows. Returns false, and appends
+  // nothing, unless the column holds integers, dates or ids.
+  bool lookup(int64_t value, std::vector<size_t>& rows) const {
+    if (!is_integral()) {
+      return false;
+    }
+    for (size_t b = hash_int64(value) & mask_; table_[b] != INVALID_VALUE;
+         b = (b + 1) & mask_) {
+      if (get_numeric(first_row(table_[b])) == value) {
+        append_rows(table_[b], rows);
+        break;
+      }
+    }
+    return true;
+  }
+
+ private:
+  bool is_string() const {
+    return type_ == DataType::kString || type_ == DataType::kLCString;
+  }
+
+  bool is_integral() const {
+    switch (type_) {
+    case DataType::kInt32:
+    case DataType::kUInt32:
+    case DataType::kInt64:
+    case DataType::kUInt64:
+    case DataType::kDate:
+    case DataType::kDateTime:
+    case DataType::kID:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  size_t value_num() const {
+    return value_offsets_.empty() ? 0 : value_offsets_.size() - 1;
+  }
+
+  size_t first_row(size_t value_id) const {
+    return rows_[value_offsets_[value_id]];
+  }
+
+  void append_rows(size_t value_id, std::vector<size_t>& rows) const {
+    rows.insert(rows.end(), rows_.begin() + value_offsets_[value_id],
+                rows_.begin() + value_offsets_[value_id + 1]);
+  }
+
+  std::string_view get_string(size_t row) const {
+    if (type_ == DataType::kString) {
+      return static_cast<const StringColumn*>(column_)->get(row);
+    } else {
+      return static_cast<const LCStringColumn*>(column_)->get(row);
+    }
+  }
+
+  template <typename T>
+  T get_as(size_t row) const {
+    return static_cast<const NumericColumn<T>*>(column_)->get(row);
+  }
+
+  int64_t get_numeric(size_t row) const {
+    switch (type_) {
+    case DataType::kInt32:
+      return get_as<int32_t>(row);
+    case DataType::kUInt32:
+      return get_as<uint32_t>(row);
+    case DataType::kInt64:
+      return get_as<int64_t>(row);
+    case DataType::kUInt64:
+      return get_as<uint64_t>(row);
+    case DataType::kDate:
+      return get_as<Date>(row).to_i32();
+    case DataType::kDateTime:
+      return get_as<DateTime>(row).to_i64();
+    case DataType::kID:
+      return get_as<gid_t>(row);
+    default:
+      return 0;
+    }
+  }
+
+  size_t hash_row(size_t row) const {
+    return is_string() ? hash_string(get_string(row))
+                       : hash_int64(get_numeric(row));
+  }
+
+  static size_t calc_table_size(size_t value_num) {
+    size_t size = 16;
+    while (static_cast<double>(value_num) / size >= MAX_LOAD_FACTOR) {
+      size *= 2;
+    }
+    return size;
+  }
+
+  bool load(const std::string& prefix, size_t row_num,
+            StorageStrategy strategy) {
+    std::string meta_fname = prefix + "_pindex_meta";
+    if (!file_exists(meta_fname)) {
+      return false;
+    }
+    std::vector<size_t> meta;
+    load_from_file(meta_fname, meta);
+    if (meta.size() != 4 || meta[0] != row_num ||
+        meta[1] != calc_table_size(meta[2]) || meta[3] != INDEX_VERSION) {
+      std::cerr << "Warning: stale property index " << prefix
+                << ", rebuilding" << std::endl;
+      return false;
+    }
+    table_.open(prefix + "_pindex", strategy);
+    value_offsets_.open(prefix + "_pindex_offsets", strategy);
+    rows_.open(prefix + "_pindex_rows", strategy);
+    row_num_ = row_num;
+    mask_ = meta[1] - 1;
+    return table_.size() == meta[1] && value_offsets_.size() == meta[2] + 1 &&
+           rows_.size() == row_num;
+  }
+
+  // The first pass numbers the distinct values in the order of their first
+  // row, growing the table as they are found. The second groups the rows by
+  // value.
+  void build(size_t row_num) {
+    std::vector<size_t> row_values(row_num);
+    std::vector<size_t> first_rows;
+    std::vector<size_t> table(calc_table_size(0), INVALID_VALUE);
+    for (size_t row = 0; row < row_num; ++row) {
+      size_t mask = table.size() - 1;
+      size_t b = hash_row(row) & mask;
+      while (table[b] != INVALID_VALUE &&
+             !same_value(first_rows[table[b]], row)) {
+        b = (b + 1) & mask;
+      }
+      if (table[b] != INVALID_VALUE) {
+        row_values[row] = table[b];
+        continue;
+      }
+      row_values[row] = table[b] = first_rows.size();
+      first_rows.push_back(row);
+      if (calc_table_size(first_rows.size()) != table.size()) {
+        table = rehash(first_rows);
+      }
+    }
+
+    std::vector<size_t> value_offsets(first_rows.size() + 1, 0);
+    for (size_t value_id : row_values) {
+      ++value_offsets[value_id + 1];
+    }
+    for (size_t i = 1; i < value_offsets.size(); ++i) {
+      value_offsets[i] += value_offsets[i - 1];
+    }
+    std::vector<size_t> rows(row_num);
+    std::vector<size_t> cursor(value_offsets.begin(), value_offsets.end() - 1);
+    for (size_t row = 0; row < row_num; ++row) {
+      rows[cursor[row_values[row]]++] = row;
+    }
+
+    mask_ = table.size() - 1;
+    table_.assign(std::move(table));
+    value_offsets_.assign(std::move(value_offsets));
+    rows_.assign(std::move(rows));
+    row_num_ = row_num;
+  }
+
+  std::vector<size_t> rehash(const std::vector<size_t>& first_rows) const {
+    std::vector<size_t> table(calc_table_size(first_rows.size()),
+                              INVALID_VALUE);
+    size_t mask = table.size() - 1;
+    for (size_t value_id = 0; value_id < first_rows.size(); ++value_id) {
+      size_t b = hash_row(first_rows[value_id]) & mask;
+      while (table[b] != INVALID_VALUE) {
+        b = (b + 1) & mask;
+      }
+      table[b] = value_id;
+    }
+    return table;
+  }
+
+  bool same_value(size_t a, size_t b) const {
+    return is_string() ? get_string(a) == get_string(b)
+                       : get_numeric(a) == get_numeric(b);
+  }
+
+  // Bumped whenever the hashes or the probing scheme change.
+  static constexpr size_t INDEX_VERSION = 3;
+
+  const IColumn* column_;
+  DataType type_;
+  size_t row_num_;
+  // Value ids, INVALID_VALUE for empty slots.
+  MmapArray<size_t> table_;
+  // The rows of value id i are rows_[value_offsets_[i], value_offsets_[i + 1]).
+  MmapArray<size_t> value_offsets_;
+  MmapArray<size_t> rows_;
+  size_t mask_;
+};
+
+}  // namespace ladder
+
+#endif  // LADDER_PROPERTY_PROPERTY_INDEX_H
@@ -0,0 +1,223 @@
+#ifndef LADDER_PROPERTY_SELECT_H
+#define LADDER_PROPERTY_SELECT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "cpu_features.h"
+
+#ifdef LADDER_HAS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace ladder {
+
+// Scan kernels over plain arrays. A selection vector holds ascending row
+// ids; kernels append to it, so that consecutive blocks can be selected
+// piecewise. A bitmap holds one bit per row.
+
+#ifdef LADDER_HAS_X86_KERNELS
+inline void append_lanes(uint32_t mask, size_t base,
+                         std::vector<size_t>& rows) {
+  while (mask != 0) {
+    rows.push_back(base + __builtin_ctz(mask));
+    mask &= mask - 1;
+  }
+}
+
+// The AVX2 kernels below handle whole vectors and return the position where
+// the scalar loop picks up.
+LADDER_TARGET_AVX2 inline size_t select_equal_avx2(const uint16_t* data,
+                                                   size_t size, uint16_t value,
+                                                   std::vector<size_t>& rows) {
+  size_t i = 0;
+  __m256i target = _mm256_set1_epi16(static_cast<int16_t>(value));
+  for (; i + 16 <= size; i += 16) {
+    __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    // Two mask bits per 16-bit lane, keep the low one.
+    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                        _mm256_cmpeq_epi16(block, target))) &
+                    0x55555555u;
+    while (mask != 0) {
+      rows.push_back(i + (__builtin_ctz(mask) >> 1));
+      mask &= mask - 1;
+    }
+  }
+  return i;
+}
+
+LADDER_TARGET_AVX2 inline size_t select_between_avx2(
+    const int32_t* data, size_t size, int32_t low, int32_t high,
+    std::vector<size_t>& rows) {
+  size_t i = 0;
+  __m256i vlow = _mm256_set1_epi32(low);
+  __m256i vhigh = _mm256_set1_epi32(high);
+  for (; i + 8 <= size; i += 8) {
+    __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(vlow, block),
+                                      _mm256_cmpgt_epi32(block, vhigh));
+    uint32_t mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xff;
+    append_lanes(mask, i, rows);
+  }
+  return i;
+}
+
+LADDER_TARGET_AVX2 inline size_t select_between_avx2(
+    const int64_t* data, size_t size, int64_t low, int64_t high,
+    std::vector<size_t>& rows) {
+  size_t i = 0;
+  __m256i vlow = _mm256_set1_epi64x(low);
+  __m256i vhigh = _mm256_set1_epi64x(high);
+  for (; i + 4 <= size; i += 4) {
+    __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(vlow, block),
+                                      _mm256_cmpgt_epi64(block, vhigh));
+    uint32_t mask = ~_mm256_movemask_pd(_mm256_castsi256_pd(outside)) & 0xf;
+    append_lanes(mask, i, rows);
+  }
+  return i;
+}
+#endif
+
+// Appends the positions of data equal to value to rows.
+inline void select_equal(const uint16_t* data, size_t size, uint16_t value,
+                         std::vector<size_t>& rows) {
+  size_t i = 0;
+#ifdef LADDER_HAS_X86_KERNELS
+  if (cpu_has_avx2()) {
+    i = select_equal_avx2(data, size, value, rows);
+  }
+#endif
+  for (; i < size; ++i) {
+    if (data[i] == value) {
+      rows.push_back(i);
+    }
+  }
+}
+
+template <typename T>
+inline void select_between_scalar(const T* data, size_t begin, size_t end,
+                                  T low, T high, std::vector<size_t>& rows) {
+  for (size_t i = begin; i < end; ++i) {
+    if (!(data[i] < low) && !(high < data[i])) {
+      rows.push_back(i);
+    }
+  }
+}
+
+// Appends the positions of data within [low, high] to rows.
+template <typename T>
+inline void select_between(const T* data, size_t size, T low, T high,
+                           std::vector<size_t>& rows) {
+  size_t i = 0;
+#ifdef LADDER_HAS_X86_KERNELS
+  if constexpr (std::is_same<T, int32_t>::value ||
+                std::is_same<T, int64_t>::value) {
+    if (cpu_has_avx2()) {
+      i = select_between_avx2(data, size, low, high, rows);
+    }
+  }
+#endif
+  select_between_scalar(data, i, size, low, high, rows);
+}
+
+// Appends the positions of data equal to value to rows.
+template <typename T>
+inline void select_equal(const T* data, size_t size, T value,
+                         std::vector<size_t>& rows) {
+  select_between(data, size, value, value, rows);
+}
+
+// Appends the positions of data less than value to rows.
+template <typename T>
+inline void select_less(const T* data, size_t size, T value,
+                        std::vector<size_t>& rows) {
+  if constexpr (std::is_integral<T>::value) {
+    if (value != std::numeric_limits<T>::min()) {
+      select_between(data, size, std::numeric_limits<T>::min(),
+                     static_cast<T>(value - 1), rows);
+    }
+  } else {
+    for (size_t i = 0; i < size; ++i) {
+      if (data[i] < value) {
+        rows.push_back(i);
+      }
+    }
+  }
+}
+
+// out[i] = data[rows[i]], prefetching a few rows ahead.
+template <typename T>
+inline void gather(const T* data, const size_t* rows, size_t num, T* out) {
+  static constexpr size_t PREFETCH_DISTANCE = 16;
+  for (size_t i = 0; i < num; ++i) {
+    if (i + PREFETCH_DISTANCE < num) {
+      __builtin_prefetch(data + rows[i + PREFETCH_DISTANCE]);
+    }
+    out[i] = data[rows[i]];
+  }
+}
+
+// Rows selected by both a and b.
+inline void selection_and(const std::vector<size_t>& a,
+                          const std::vector<size_t>& b,
+                          std::vector<size_t>& out) {
+  out.clear();
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                        std::back_inserter(out));
+}
+
+// Rows selected by a or b.
+inline void selection_or(const std::vector<size_t>& a,
+                         const std::vector<size_t>& b,
+                         std::vector<size_t>& out) {
+  out.clear();
+  std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+                 std::back_inserter(out));
+}
+
+inline void selection_to_bitmap(const std::vector<size_t>& rows,
+                                size_t row_num, std::vector<uint64_t>& bitmap) {
+  bitmap.assign((row_num + 63) / 64, 0);
+  for (size_t row : rows) {
+    bitmap[row >> 6] |= 1ULL << (row & 63);
+  }
+}
+
+inline void bitmap_to_selection(const std::vector<uint64_t>& bitmap,
+                                std::vector<size_t>& rows) {
+  for (size_t w = 0; w < bitmap.size(); ++w) {
+    uint64_t word = bitmap[w];
+    while (word != 0) {
+      rows.push_back((w << 6) + __builtin_ctzll(word));
+      word &= word - 1;
+    }
+  }
+}
+
+// bitmap &= rhs, both covering the same rows.
+inline void bitmap_and(std::vector<uint64_t>& bitmap,
+                       const std::vector<uint64_t>& rhs) {
+  for (size_t w = 0; w < bitmap.size(); ++w) {
+    bitmap[w] &= rhs[w];
+  }
+}
+
+// bitmap |= rhs, both covering the same rows.
+inline void bitmap_or(std::vector<uint64_t>& bitmap,
+                      const std::vector<uint64_t>& rhs) {
+  for (size_t w = 0; w < bitmap.size(); ++w) {
+    bitmap[w] |= rhs[w];
+  }
+}
+
+}  // namespace ladder
+
+#endif  // LADDER_PROPERTY_SELECT_H
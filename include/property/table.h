@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "property/column.h"
+#include "property/property_index.h"
 
 namespace ladder {
 
@@ -18,19 +19,116 @@ class Table {
         delete column;
       }
     }
+    for (auto index : indices_) {
+      if (index != nullptr) {
+        delete index;
+      }
+    }
   }
 
   void open(const std::string& prefix,
-            const std::vector<std::pair<std::string, DataType>>& header) {
+            const std::vector<std::pair<std::string, DataType>>& header,
+            StorageStrategy strategy) {
+    init(header);
+    for (size_t i = 0; i < columns_.size(); ++i) {
+      open_column(prefix, i, strategy);
+    }
+    update_row_num();
+  }
+
+  // init(), open_column() for every column and update_row_num() is
+  // equivalent to open(), and lets the columns be loaded concurrently.
+  void init(const std::vector<std::pair<std::string, DataType>>& header) {
     size_t col_num = header.size();
     columns_.resize(col_num, nullptr);
-    size_t min_row_num = std::numeric_limits<size_t>::max();
+    indices_.resize(col_num, nullptr);
+    types_.resize(col_num);
     for (size_t i = 0; i < col_num; ++i) {
       columns_[i] = create_column(header[i].second);
-      columns_[i]->open(prefix + "_col_" + std::to_string(i));
+      types_[i] = header[i].second;
       header_[header[i].first] = i;
+    }
+  }
 
-      min_row_num = std::min(min_row_num, columns_[i]->size());
+  void open_column(const std::string& prefix, size_t idx,
+                   StorageStrategy strategy) {
+    columns_[idx]->open(prefix + "_col_" + std::to_string(idx), strategy);
+  }
+
+  // The column must be a StringColumn.
+  void build_dictionary(size_t idx) {
+    dynamic_cast<StringColumn*>(columns_[idx])->build_dictionary();
+  }
+
+  // Loads the persisted secondary index of an opened column, or builds it.
+  // Indices of different columns can be opened concurrently.
+  void open_index(const std::string& prefix, size_t idx,
+                  StorageStrategy strategy) {
+    indices_[idx] = new PropertyIndex(columns_[idx], types_[idx]);
+    indices_[idx]->open(prefix + "_col_" + std::to_string(idx),
+                        columns_[idx]->size(), strategy);
+  }
+
+  bool dump_index(const std::string& prefix, size_t idx) const {
+    return indices_[idx] != nullptr &&
+           indices_[idx]->dump(prefix + "_col_" + std::to_string(idx));
+  }
+
+  // Zone maps and sorted indices are kept for Date and DateTime columns
+  // only; the calls below are no-ops on other columns.
+  void open_zone_map(const std::string& prefix, size_t idx,
+                     StorageStrategy strategy) {
+    std::string col_prefix = prefix + "_col_" + std::to_string(idx);
+    visit_temporal_column(idx, [&](auto& column) {
+      column.open_zone_map(col_prefix, strategy);
+    });
+  }
+
+  bool dump_zone_map(const std::string& prefix, size_t idx) const {
+    std::string col_prefix = prefix + "_col_" + std::to_string(idx);
+    bool ret = false;
+    visit_temporal_column(idx, [&](auto& column) {
+      ret = column.dump_zone_map(col_prefix);
+    });
+    return ret;
+  }
+
+  void open_sorted_index(const std::string& prefix, size_t idx,
+                         StorageStrategy strategy) {
+    std::string col_prefix = prefix + "_col_" + std::to_string(idx);
+    visit_temporal_column(idx, [&](auto& column) {
+      column.open_sorted_index(col_prefix, strategy);
+    });
+  }
+
+  bool dump_sorted_index(const std::string& prefix, size_t idx) const {
+    std::string col_prefix = prefix + "_col_" + std::to_string(idx);
+    bool ret = false;
+    visit_temporal_column(idx, [&](auto& column) {
+      ret = column.dump_sorted_index(col_prefix);
+    });
+    return ret;
+  }
+
+  // Appends the rows whose property name equals value to rows. Returns false
+  // if the property has no secondary index, or if it is numeric and value a
+  // string or the other way round.
+  bool lookup(const std::string& name, std::string_view value,
+              std::vector<size_t>& rows) const {
+    const PropertyIndex* index = get_index_by_name(name);
+    return index != nullptr && index->lookup(value, rows);
+  }
+
+  bool lookup(const std::string& name, int64_t value,
+              std::vector<size_t>& rows) const {
+    const PropertyIndex* index = get_index_by_name(name);
+    return index != nullptr && index->lookup(value, rows);
+  }
+
+  void update_row_num() {
+    size_t min_row_num = std::numeric_limits<size_t>::max();
+    for (auto column : columns_) {
+      min_row_num = std::min(min_row_num, column->size());
     }
 
     if (min_row_num == std::numeric_limits<size_t>::max()) {
@@ -52,8 +150,33 @@ class Table {
     return columns_[it->second];
   }
 
+  // nullptr if the column does not hold T.
+  template <typename T>
+  const NumericColumn<T>* get_numeric_column(const std::string& name) const {
+    return dynamic_cast<const NumericColumn<T>*>(get_column_by_name(name));
+  }
+
+  const PropertyIndex* get_index_by_name(const std::string& name) const {
+    auto it = header_.find(name);
+    if (it == header_.end()) {
+      return nullptr;
+    }
+    return indices_[it->second];
+  }
+
  private:
+  template <typename FUNC_T>
+  void visit_temporal_column(size_t idx, const FUNC_T& func) const {
+    if (types_[idx] == DataType::kDate) {
+      func(*static_cast<NumericColumn<Date>*>(columns_[idx]));
+    } else if (types_[idx] == DataType::kDateTime) {
+      func(*static_cast<NumericColumn<DateTime>*>(columns_[idx]));
+    }
+  }
+
   std::vector<IColumn*> columns_;
+  std::vector<PropertyIndex*> indices_;
+  std::vector<DataType> types_;
   std::unordered_map<std::string, size_t> header_;
   size_t row_num_;
 };
@@ -0,0 +1,91 @@
+#ifndef LADDER_THREAD_POOL_H_
+#define LADDER_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace ladder {
+
+// Fixed-size pool executing independent tasks in FIFO order.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int thread_num) : pending_(0), stopped_(false) {
+    if (thread_num < 1) {
+      thread_num = 1;
+    }
+    for (int i = 0; i < thread_num; ++i) {
+      threads_.emplace_back([this]() { loop(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto& thrd : threads_) {
+      thrd.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void submit(std::function<void()>&& task) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      tasks_.emplace(std::move(task));
+      ++pending_;
+    }
+    task_cv_.notify_one();
+  }
+
+  // Blocks until every submitted task has finished.
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() { return pending_ == 0; });
+  }
+
+  int thread_num() const { return threads_.size(); }
+
+ private:
+  void loop() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        task_cv_.wait(lock, [this]() { return stopped_ || !tasks_.empty(); });
+        if (tasks_.empty()) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop();
+      }
+      task();
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (--pending_ == 0) {
+          done_cv_.notify_all();
+        }
+      }
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::queue<std::function<void()>> tasks_;
+  size_t pending_;
+  bool stopped_;
+
+  std::mutex mutex_;
+  std::condition_variable task_cv_;
+  std::condition_variable done_cv_;
+};
+
+}  // namespace ladder
+
+#endif  // LADDER_THREAD_POOL_H_
@@ -1,6 +1,10 @@
 #ifndef LADDER_UTILS_H_
 #define LADDER_UTILS_H_
 
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -8,7 +12,7 @@
 
 namespace ladder {
 
-size_t get_file_size(const std::string& fname) {
+inline size_t get_file_size(const std::string& fname) {
   std::ifstream file(fname, std::ios::ate | std::ios::binary);
   if (!file.is_open()) {
     std::cerr << "Error: cannot open file " << fname << std::endl;
@@ -30,6 +34,44 @@ void load_from_file(const std::string& fname, std::vector<T>& data) {
   file.read(reinterpret_cast<char*>(data.data()), vec_size * sizeof(T));
 }
 
+template <typename T>
+bool dump_to_file(const std::string& fname, const T* data, size_t size) {
+  std::ofstream file(fname, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    std::cerr << "Error: cannot open file " << fname << std::endl;
+    return false;
+  }
+  file.write(reinterpret_cast<const char*>(data), size * sizeof(T));
+  return file.good();
+}
+
+inline bool file_exists(const std::string& fname) {
+  std::ifstream file(fname);
+  return file.good();
+}
+
+// Modification time of fname in nanoseconds, 0 if it does not exist.
+inline uint64_t get_file_mtime(const std::string& fname) {
+  struct stat st;
+  if (stat(fname.c_str(), &st) != 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ULL +
+         st.st_mtim.tv_nsec;
+}
+
+// Like dump_to_file, but writes a temporary file and renames it over fname, so
+// that processes which mapped the old file keep reading it intact.
+template <typename T>
+bool replace_file(const std::string& fname, const T* data, size_t size) {
+  std::string tmp_fname = fname + ".tmp";
+  if (!dump_to_file(tmp_fname, data, size)) {
+    std::remove(tmp_fname.c_str());
+    return false;
+  }
+  return std::rename(tmp_fname.c_str(), fname.c_str()) == 0;
+}
+
 }  // namespace ladder
 
 #endif  // LADDER_UTILS_H_
\ No newline at end of file
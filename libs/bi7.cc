@@ -1,5 +1,6 @@
 #include <assert.h>
 
+#include <limits>
 #include <queue>
 #include <string_view>
 
@@ -11,19 +12,56 @@
 #include "ladder/in_stream.h"
 #include "ladder/operator.h"
 #include "ladder/out_stream.h"
+#include "ladder/split_expander.h"
 
 namespace ladder {
 
 class Resource {};
 
+// Number of input tuples whose vertex lookups are resolved together.
+static constexpr size_t BATCH_SIZE = 256;
+static constexpr vertex_t INVALID_VERTEX = std::numeric_limits<vertex_t>::max();
+
+// All subgraphs used here keep the default layout, so expansions are inlined.
+using CsrView = TypedGraphView<Csr>;
+
+// Csr of a subgraph read through CsrView. Fails if the schema selected another
+// layout for it, which CsrView cannot read.
+inline const ICsr* get_default_csr(const GraphDB& graph_db, label_t src_label,
+                                   label_t edge_label, label_t dst_label,
+                                   Direction dir) {
+  const Schema& schema = graph_db.schema();
+  CsrLayout layout = dir == Direction::kOutgoing
+                         ? schema.oe_layout(src_label, edge_label, dst_label)
+                         : schema.ie_layout(src_label, edge_label, dst_label);
+  const ICsr* csr = nullptr;
+  if (layout == CsrLayout::kDefault) {
+    csr = graph_db.get_csr(src_label, edge_label, dst_label, dir);
+  }
+  if (dynamic_cast<const Csr*>(csr) == nullptr) {
+    LOG(FATAL) << "bi7 reads (" << static_cast<int>(src_label) << ", "
+               << static_cast<int>(edge_label) << ", "
+               << static_cast<int>(dst_label) << ") "
+               << (dir == Direction::kOutgoing ? "outgoing" : "incoming")
+               << " edges with the default multi-edge layout, but the schema "
+                  "selects another one";
+  }
+  return csr;
+}
+
 class GraphStore {
  public:
   GraphStore(const GraphDB& graph_db)
-      : subgraph_2_1_7_in(graph_db.get_csr(2, 1, 7, Direction::kIncoming)),
-        subgraph_2_3_2_in(graph_db.get_csr(2, 3, 2, Direction::kIncoming)),
-        subgraph_3_1_7_in(graph_db.get_csr(3, 1, 7, Direction::kIncoming)),
-        subgraph_2_1_7_out(graph_db.get_csr(2, 1, 7, Direction::kOutgoing)),
-        subgraph_2_3_3_in(graph_db.get_csr(2, 3, 3, Direction::kIncoming)),
+      : subgraph_2_1_7_in(
+            get_default_csr(graph_db, 2, 1, 7, Direction::kIncoming)),
+        subgraph_2_3_2_in(
+            get_default_csr(graph_db, 2, 3, 2, Direction::kIncoming)),
+        subgraph_3_1_7_in(
+            get_default_csr(graph_db, 3, 1, 7, Direction::kIncoming)),
+        subgraph_2_1_7_out(
+            get_default_csr(graph_db, 2, 1, 7, Direction::kOutgoing)),
+        subgraph_2_3_3_in(
+            get_default_csr(graph_db, 2, 3, 3, Direction::kIncoming)),
         property_name_7(*dynamic_cast<const StringColumn*>(
             graph_db.get_vertex_property(7, "name"))),
         graph_db_(graph_db) {}
@@ -45,15 +83,28 @@ class GraphStore {
     return graph_db_.vertex_map().get_internal_id(global_id, internal_id);
   }
 
+  size_t get_internal_ids(const std::vector<gid_t>& global_ids,
+                          std::vector<vertex_t>& internal_ids) const {
+    internal_ids.resize(global_ids.size());
+    return graph_db_.vertex_map().get_internal_ids(
+        global_ids.data(), global_ids.size(), internal_ids.data());
+  }
+
+  bool lookup_vertices(label_t label, const std::string& name,
+                       const std::string& value,
+                       std::vector<vertex_t>& vertices) const {
+    return graph_db_.lookup_vertices(label, name, value, vertices);
+  }
+
   label_t get_label_id(gid_t global_id) const {
     return graph_db_.vertex_map().get_label_id(global_id);
   }
 
-  GraphView subgraph_2_1_7_in;
-  GraphView subgraph_2_3_2_in;
-  GraphView subgraph_3_1_7_in;
-  GraphView subgraph_2_1_7_out;
-  GraphView subgraph_2_3_3_in;
+  CsrView subgraph_2_1_7_in;
+  CsrView subgraph_2_3_2_in;
+  CsrView subgraph_3_1_7_in;
+  CsrView subgraph_2_1_7_out;
+  CsrView subgraph_2_3_3_in;
 
   const StringColumn& property_name_7;
 
@@ -76,14 +127,15 @@ class Stream1 : public INullaryOperator {
     size_t vnum = graph.get_vertices_num(7);
     std::string tag = casted_context.get_param("tag");
     auto& self_output = output[casted_context.global_worker_id()];
-    for (vertex_t i = 0; i < vnum; ++i) {
-      if (graph.is_valid_vertex(7, i)) {
-        std::string_view tag_name = graph.property_name_7.get(i);
-        if (tag_name == tag) {
-          gid_t vertex_global_id;
-          if (graph.get_global_id(7, i, vertex_global_id)) {
-            self_output << vertex_global_id;
-          }
+    std::vector<vertex_t> rows;
+    if (!graph.lookup_vertices(7, "name", tag, rows)) {
+      graph.property_name_7.select_equal(tag, rows);
+    }
+    for (vertex_t i : rows) {
+      if (i < vnum && graph.is_valid_vertex(7, i)) {
+        gid_t vertex_global_id;
+        if (graph.get_global_id(7, i, vertex_global_id)) {
+          self_output << vertex_global_id;
         }
       }
     }
@@ -96,30 +148,32 @@ class Stream2 : public IUnaryOperator {
                std::vector<InStream>& output) override {
     auto& casted_context = dynamic_cast<GraphJobContext&>(context);
     auto& graph = casted_context.graph;
-
-    gid_t cur_global_id;
+    int worker_num = casted_context.local_worker_num();
+    int server_num = casted_context.server_num();
+    // Every local worker reads all tags, see Stream1, and expands the ones
+    // it owns.
+    SplitExpander<CsrView> expander(
+        casted_context, {&graph.subgraph_2_1_7_in, &graph.subgraph_3_1_7_in});
+
+    auto emit = [&](gid_t src, gid_t nbr) {
+      int target_worker = CsrView::get_partition(nbr, worker_num, server_num);
+      output[target_worker].emit(src, nbr);
+    };
+
+    std::vector<gid_t> global_ids;
+    std::vector<vertex_t> vertex_ids;
     while (!input.empty()) {
-      input >> cur_global_id;
-      vertex_t vertex_id;
-      if (graph.get_internal_id(cur_global_id, vertex_id)) {
-        for (auto& e : graph.subgraph_2_1_7_in.get_partial_edges(
-                 vertex_id, casted_context.local_worker_id(),
-                 casted_context.local_worker_num())) {
-          int target_worker =
-              get_partition(e, casted_context.local_worker_num(),
-                            casted_context.server_num());
-          output[target_worker] << cur_global_id << e;
-        }
-        for (auto& e : graph.subgraph_3_1_7_in.get_partial_edges(
-                 vertex_id, casted_context.local_worker_id(),
-                 casted_context.local_worker_num())) {
-          int target_worker =
-              get_partition(e, casted_context.local_worker_num(),
-                            casted_context.server_num());
-          output[target_worker] << cur_global_id << e;
-        }
+      global_ids.clear();
+      while (!input.empty() && global_ids.size() < BATCH_SIZE) {
+        gid_t cur_global_id;
+        input >> cur_global_id;
+        global_ids.push_back(cur_global_id);
       }
+      graph.get_internal_ids(global_ids, vertex_ids);
+      expander.expand(global_ids.data(), vertex_ids.data(), global_ids.size(),
+                      emit);
     }
+    expander.finish(emit);
   }
 };
 
@@ -129,28 +183,50 @@ class Stream3 : public IUnaryOperator {
                std::vector<InStream>& output) override {
     auto& casted_context = dynamic_cast<GraphJobContext&>(context);
     auto& graph = casted_context.graph;
-
-    gid_t tag, message;
+    int worker_num = casted_context.local_worker_num();
+    // Indexed by the label of a message minus 2.
+    const CsrView* subgraphs[] = {&graph.subgraph_2_3_2_in,
+                                  &graph.subgraph_2_3_3_in};
+
+    std::vector<gid_t> tags, messages;
+    std::vector<vertex_t> vertex_ids;
+    std::vector<size_t> rows[2];
+    std::vector<vertex_t> batches[2];
+    std::vector<ExpandedEdge> edges;
     while (!input.empty()) {
-      input >> tag >> message;
-      vertex_t vertex_id;
-      if (graph.get_internal_id(message, vertex_id)) {
-        label_t vertex_label = graph.get_label_id(message);
-        if (vertex_label == 2) {
-          for (auto& e : graph.subgraph_2_3_2_in.get_edges(vertex_id)) {
-            int target_worker =
-                get_partition(e, casted_context.local_worker_num(),
-                              casted_context.server_num());
-            output[target_worker] << tag << message << e;
-          }
-        } else {
-          assert(vertex_label == 3);
-          for (auto& e : graph.subgraph_2_3_3_in.get_edges(vertex_id)) {
-            int target_worker =
-                get_partition(e, casted_context.local_worker_num(),
-                              casted_context.server_num());
-            output[target_worker] << tag << message << e;
-          }
+      tags.clear();
+      messages.clear();
+      while (!input.empty() && messages.size() < BATCH_SIZE) {
+        gid_t tag, message;
+        input >> tag >> message;
+        tags.push_back(tag);
+        messages.push_back(message);
+      }
+      graph.get_internal_ids(messages, vertex_ids);
+      // Messages of either label are expanded as one batch per label; rows
+      // maps a batch position back to its input row.
+      for (int label = 0; label < 2; ++label) {
+        rows[label].clear();
+        batches[label].clear();
+      }
+      for (size_t i = 0; i < messages.size(); ++i) {
+        if (vertex_ids[i] == INVALID_VERTEX) {
+          continue;
+        }
+        label_t vertex_label = graph.get_label_id(messages[i]);
+        assert(vertex_label == 2 || vertex_label == 3);
+        rows[vertex_label - 2].push_back(i);
+        batches[vertex_label - 2].push_back(vertex_ids[i]);
+      }
+      for (int label = 0; label < 2; ++label) {
+        edges.clear();
+        subgraphs[label]->expand(batches[label].data(),
+                                 batches[label].size(), edges);
+        for (auto& e : edges) {
+          size_t row = rows[label][e.src_idx];
+          int target_worker = CsrView::get_partition(
+              e.neighbor, worker_num, casted_context.server_num());
+          output[target_worker].emit(tags[row], messages[row], e.neighbor);
         }
       }
     }
@@ -166,21 +242,27 @@ class Stream4 : public IUnaryOperator {
 
     std::unordered_map<gid_t, int> tag_count;
 
-    gid_t tag, message, reply;
+    std::vector<gid_t> tags, replies;
+    std::vector<vertex_t> vertex_ids;
     while (!input.empty()) {
-      input >> tag >> message >> reply;
-      vertex_t vertex_id;
-      if (graph.get_internal_id(reply, vertex_id)) {
-        label_t vertex_label = graph.get_label_id(reply);
-        assert(vertex_label == 2);
-        bool not_has_tag = true;
-        for (auto& e : graph.subgraph_2_1_7_out.get_edges(vertex_id)) {
-          if (e == tag) {
-            not_has_tag = false;
-            break;
-          }
+      tags.clear();
+      replies.clear();
+      while (!input.empty() && replies.size() < BATCH_SIZE) {
+        gid_t tag, message, reply;
+        input >> tag >> message >> reply;
+        tags.push_back(tag);
+        replies.push_back(reply);
+      }
+      graph.get_internal_ids(replies, vertex_ids);
+      for (size_t i = 0; i < replies.size(); ++i) {
+        gid_t tag = tags[i];
+        vertex_t vertex_id = vertex_ids[i];
+        if (vertex_id == INVALID_VERTEX) {
+          continue;
         }
-        if (not_has_tag) {
+        label_t vertex_label = graph.get_label_id(replies[i]);
+        assert(vertex_label == 2);
+        if (!graph.subgraph_2_1_7_out.has_edge(vertex_id, tag)) {
           for (auto& e : graph.subgraph_2_1_7_out.get_edges(vertex_id)) {
             tag_count[e] += 1;
           }
@@ -191,7 +273,7 @@ class Stream4 : public IUnaryOperator {
       int target_worker =
           get_partition(pair.first, casted_context.local_worker_num(),
                         casted_context.server_num());
-      output[target_worker] << pair.first << pair.second;
+      output[target_worker].emit(pair.first, pair.second);
     }
   }
 };
@@ -317,7 +399,8 @@ class Stream6 : public IUnaryOperator {
 extern "C" void* create_dataflow() {
   auto dataflow = new ladder::DataFlow();
   int op_1 =
-      dataflow->add_nullary_operator(std::make_unique<ladder::Stream1>());
+      dataflow->add_nullary_operator(std::make_unique<ladder::Stream1>(),
+                                     ladder::Routing::kLocal);
   int op_2 =
       dataflow->add_unary_operator(std::make_unique<ladder::Stream2>(), op_1);
   int op_3 =
@@ -325,9 +408,11 @@ extern "C" void* create_dataflow() {
   int op_4 =
       dataflow->add_unary_operator(std::make_unique<ladder::Stream4>(), op_3);
   int op_5 =
-      dataflow->add_unary_operator(std::make_unique<ladder::Stream5>(), op_4);
+      dataflow->add_unary_operator(std::make_unique<ladder::Stream5>(), op_4,
+                                   ladder::Routing::kGather);
   int op_6 =
-      dataflow->add_unary_operator(std::make_unique<ladder::Stream6>(), op_5);
+      dataflow->add_unary_operator(std::make_unique<ladder::Stream6>(), op_5,
+                                   ladder::Routing::kLocal);
   dataflow->sink(op_6);
   return dataflow;
 }
@@ -26,6 +26,19 @@ DataType json_type_str_to_enum(const std::string& val) {
   }
 }
 
+CsrLayout json_layout_str_to_enum(const std::string& val) {
+  if (val == "Default") {
+    return CsrLayout::kDefault;
+  } else if (val == "Compact") {
+    return CsrLayout::kCompact;
+  } else if (val == "Compressed") {
+    return CsrLayout::kCompressed;
+  } else {
+    std::cerr << "Error: unsupported csr layout " << val << std::endl;
+    return CsrLayout::kDefault;
+  }
+}
+
 PartitionType json_partition_str_to_enum(const std::string& val) {
   if (val == "Dynamic") {
     return PartitionType::kDynamic;
@@ -52,6 +65,10 @@ void Schema::open(const std::string& json_file) {
   vertex_prop_meta_.clear();
   vertex_prop_vec_.clear();
   vertex_partition_type_.clear();
+  vertex_prop_dictionary_.clear();
+  vertex_prop_indexed_.clear();
+  vertex_prop_zone_map_.clear();
+  vertex_prop_sorted_index_.clear();
 
   try {
     json j = json::parse(json_str);
@@ -68,6 +85,10 @@ void Schema::open(const std::string& json_file) {
 
       std::vector<std::pair<std::string, DataType>> prop_vec;
       std::unordered_map<std::string, std::pair<DataType, size_t>> prop_meta;
+      std::set<size_t> prop_dictionary;
+      std::set<size_t> prop_indexed;
+      std::set<size_t> prop_zone_map;
+      std::set<size_t> prop_sorted_index;
       for (auto& prop_node : vertex_node["properties"]) {
         std::string prop_name = prop_node["name"].get<std::string>();
         // std::cout << "property name - " << prop_name << std::endl;
@@ -77,10 +98,56 @@ void Schema::open(const std::string& json_file) {
 
         prop_vec.push_back(std::make_pair(prop_name, prop_type_enum));
         prop_meta[prop_name] = {prop_type_enum, prop_vec.size() - 1};
+
+        if (prop_node.contains("dictionary") &&
+            prop_node["dictionary"].get<bool>()) {
+          if (prop_type_enum != DataType::kString) {
+            std::cerr << "Error: " << prop_name
+                      << " is not a String, ignore dictionary" << std::endl;
+          } else {
+            prop_dictionary.insert(prop_vec.size() - 1);
+          }
+        }
+        if (prop_node.contains("indexed") && prop_node["indexed"].get<bool>()) {
+          if (prop_type_enum == DataType::kFloat ||
+              prop_type_enum == DataType::kDouble ||
+              prop_type_enum == DataType::kNull) {
+            std::cerr << "Error: " << prop_name
+                      << " cannot be indexed, ignore indexed" << std::endl;
+          } else {
+            prop_indexed.insert(prop_vec.size() - 1);
+          }
+        }
+        if (prop_node.contains("zone_map") &&
+            prop_node["zone_map"].get<bool>()) {
+          if (prop_type_enum != DataType::kDate &&
+              prop_type_enum != DataType::kDateTime) {
+            std::cerr << "Error: " << prop_name
+                      << " is not a Date or DateTime, ignore zone_map"
+                      << std::endl;
+          } else {
+            prop_zone_map.insert(prop_vec.size() - 1);
+          }
+        }
+        if (prop_node.contains("sorted_index") &&
+            prop_node["sorted_index"].get<bool>()) {
+          if (prop_type_enum != DataType::kDate &&
+              prop_type_enum != DataType::kDateTime) {
+            std::cerr << "Error: " << prop_name
+                      << " is not a Date or DateTime, ignore sorted_index"
+                      << std::endl;
+          } else {
+            prop_sorted_index.insert(prop_vec.size() - 1);
+          }
+        }
       }
 
       vertex_prop_vec_.push_back(std::move(prop_vec));
       vertex_prop_meta_.push_back(std::move(prop_meta));
+      vertex_prop_dictionary_.push_back(std::move(prop_dictionary));
+      vertex_prop_indexed_.push_back(std::move(prop_indexed));
+      vertex_prop_zone_map_.push_back(std::move(prop_zone_map));
+      vertex_prop_sorted_index_.push_back(std::move(prop_sorted_index));
     }
 
     edge_type_to_id_.clear();
@@ -88,6 +155,10 @@ void Schema::open(const std::string& json_file) {
     edge_prop_vec_.clear();
     ie_single_.clear();
     oe_single_.clear();
+    ie_layout_.clear();
+    oe_layout_.clear();
+    ie_sorted_.clear();
+    oe_sorted_.clear();
     label_t cur_edge_label = 0;
     for (auto& edge_node : j["edge"]) {
       std::string src_label_name = edge_node["src_label"].get<std::string>();
@@ -134,6 +205,46 @@ void Schema::open(const std::string& json_file) {
           prop_meta[prop_name] = {prop_type_enum, prop_vec.size() - 1};
         }
       }
+      // Non-default layouts may reorder edges, which would detach them from
+      // their property rows.
+      if (edge_node.contains("oe_layout")) {
+        CsrLayout layout =
+            json_layout_str_to_enum(edge_node["oe_layout"].get<std::string>());
+        if (layout != CsrLayout::kDefault && !prop_vec.empty()) {
+          std::cerr << "Error: " << edge_label_name
+                    << " has properties, ignore oe_layout" << std::endl;
+        } else {
+          oe_layout_[triplet] = layout;
+        }
+      }
+      if (edge_node.contains("ie_layout")) {
+        CsrLayout layout =
+            json_layout_str_to_enum(edge_node["ie_layout"].get<std::string>());
+        if (layout != CsrLayout::kDefault && !prop_vec.empty()) {
+          std::cerr << "Error: " << edge_label_name
+                    << " has properties, ignore ie_layout" << std::endl;
+        } else {
+          ie_layout_[triplet] = layout;
+        }
+      }
+      if (edge_node.contains("oe_sorted") &&
+          edge_node["oe_sorted"].get<bool>()) {
+        if (!prop_vec.empty()) {
+          std::cerr << "Error: " << edge_label_name
+                    << " has properties, ignore oe_sorted" << std::endl;
+        } else {
+          oe_sorted_.insert(triplet);
+        }
+      }
+      if (edge_node.contains("ie_sorted") &&
+          edge_node["ie_sorted"].get<bool>()) {
+        if (!prop_vec.empty()) {
+          std::cerr << "Error: " << edge_label_name
+                    << " has properties, ignore ie_sorted" << std::endl;
+        } else {
+          ie_sorted_.insert(triplet);
+        }
+      }
       edge_prop_meta_.insert({triplet, prop_meta});
       edge_prop_vec_.insert({triplet, prop_vec});
     }
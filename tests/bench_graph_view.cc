@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "graph/graph_db.h"
+#include "graph/graph_view.h"
+
+// Per-edge cost of expanding every vertex of a csr through ICsr, GraphView
+// and TypedGraphView, and of expanding them in a shuffled order, as
+// operators see them after a shuffle, one at a time and in batches. Each run
+// is kept out of line so that the compiler cannot see the dynamic type of the
+// csr, and publishes its result so that repeated runs are not folded.
+volatile ladder::gid_t checksum;
+
+template <typename VIEW_T>
+__attribute__((noinline)) ladder::gid_t expand_all(const VIEW_T& view,
+                                                   size_t vertex_num) {
+  ladder::gid_t sum = 0;
+  for (ladder::vertex_t v = 0; v < vertex_num; ++v) {
+    for (auto e : view.get_edges(v)) {
+      sum += e;
+    }
+  }
+  checksum = sum;
+  return sum;
+}
+
+struct ShuffledExpansion {
+  static constexpr size_t BATCH = 256;
+  static constexpr int WORKER_NUM = 4;
+
+  ShuffledExpansion(const ladder::ICsr* csr, size_t vertex_num, bool batched)
+      : view(csr), vertices(vertex_num), batched(batched) {
+    for (size_t v = 0; v < vertex_num; ++v) {
+      vertices[v] = v;
+    }
+    std::shuffle(vertices.begin(), vertices.end(), std::mt19937(0));
+  }
+
+  ladder::TypedGraphView<ladder::Csr> view;
+  std::vector<ladder::vertex_t> vertices;
+  bool batched;
+};
+
+// Routes every (source, neighbor) pair to a per-worker buffer, as expand
+// operators do.
+__attribute__((noinline)) ladder::gid_t expand_all(
+    const ShuffledExpansion& expansion, size_t vertex_num) {
+  std::vector<ladder::gid_t> output[ShuffledExpansion::WORKER_NUM];
+  auto emit = [&output](ladder::gid_t src, ladder::gid_t nbr) {
+    auto& out = output[ladder::get_partition(
+        nbr, ShuffledExpansion::WORKER_NUM, 1)];
+    out.push_back(src);
+    out.push_back(nbr);
+  };
+  if (expansion.batched) {
+    std::vector<ladder::ExpandedEdge> edges;
+    for (size_t i = 0; i < vertex_num; i += ShuffledExpansion::BATCH) {
+      const ladder::vertex_t* batch = expansion.vertices.data() + i;
+      edges.clear();
+      expansion.view.expand(
+          batch, std::min(ShuffledExpansion::BATCH, vertex_num - i), edges);
+      for (auto& e : edges) {
+        emit(batch[e.src_idx], e.neighbor);
+      }
+    }
+  } else {
+    for (ladder::vertex_t v : expansion.vertices) {
+      for (auto e : expansion.view.get_edges(v)) {
+        emit(v, e);
+      }
+    }
+  }
+  ladder::gid_t sum = 0;
+  for (auto& out : output) {
+    for (size_t i = 1; i < out.size(); i += 2) {
+      sum += out[i];
+    }
+  }
+  checksum = sum;
+  return sum;
+}
+
+template <typename VIEW_T>
+void bench(const std::string& name, const VIEW_T& view, size_t vertex_num,
+           size_t edge_num, int rounds) {
+  ladder::gid_t sum = expand_all(view, vertex_num);
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < rounds; ++i) {
+    sum += expand_all(view, vertex_num);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                  .count();
+  std::cout << name << ": " << ns / rounds / edge_num << " ns/edge (" << sum
+            << ")" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 5) {
+    std::cerr << "Usage: " << argv[0]
+              << " <prefix> <src_label> <edge_label> <dst_label> [rounds]"
+              << std::endl;
+    return 1;
+  }
+  std::string prefix = argv[1];
+  ladder::label_t src_label = atoi(argv[2]);
+  ladder::label_t edge_label = atoi(argv[3]);
+  ladder::label_t dst_label = atoi(argv[4]);
+  int rounds = argc > 5 ? atoi(argv[5]) : 10;
+
+  ladder::GraphDB graph;
+  graph.open(prefix, 0, 1);
+  const ladder::ICsr* csr = graph.get_csr(src_label, edge_label, dst_label,
+                                          ladder::Direction::kOutgoing);
+  size_t vertex_num = csr->vertex_num();
+  size_t edge_num = std::max<size_t>(csr->edge_num(), 1);
+  std::cout << "vertex num: " << vertex_num << ", edge num: " << edge_num
+            << std::endl;
+
+  bench("ICsr", *csr, vertex_num, edge_num, rounds);
+  bench("GraphView", ladder::GraphView(csr), vertex_num, edge_num, rounds);
+  bench("TypedGraphView<Csr>", ladder::TypedGraphView<ladder::Csr>(csr),
+        vertex_num, edge_num, rounds);
+  bench("shuffled get_edges", ShuffledExpansion(csr, vertex_num, false),
+        vertex_num, edge_num, rounds);
+  bench("shuffled expand", ShuffledExpansion(csr, vertex_num, true),
+        vertex_num, edge_num, rounds);
+
+  return 0;
+}
@@ -0,0 +1,64 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ladder/thread_group.h"
+
+// Fixed cost of one dataflow step: running an empty operator on every local
+// worker and an empty shuffle on a send and a receive thread, with threads
+// created per step as before and with long-lived thread groups.
+volatile int checksum;
+
+void empty_task(int tid) { checksum = tid; }
+
+double spawned_steps(int worker_num, int steps) {
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int step = 0; step < steps; ++step) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < worker_num; ++i) {
+      threads.emplace_back(empty_task, i);
+    }
+    for (auto& thrd : threads) {
+      thrd.join();
+    }
+    std::thread send_thread(empty_task, 0);
+    std::thread recv_thread(empty_task, 1);
+    recv_thread.join();
+    send_thread.join();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+      .count();
+}
+
+double grouped_steps(int worker_num, int steps) {
+  ladder::ThreadGroup worker_threads(worker_num);
+  ladder::ThreadGroup comm_threads(2);
+  std::function<void(int)> task = empty_task;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int step = 0; step < steps; ++step) {
+    worker_threads.run(task);
+    comm_threads.run(task);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+      .count();
+}
+
+int main(int argc, char** argv) {
+  int worker_num =
+      argc > 1 ? atoi(argv[1]) : std::thread::hardware_concurrency();
+  int steps = argc > 2 ? atoi(argv[2]) : 1000;
+  std::cout << "workers: " << worker_num << ", steps: " << steps << std::endl;
+
+  double spawned = spawned_steps(worker_num, steps);
+  double grouped = grouped_steps(worker_num, steps);
+  std::cout << "threads per step: " << spawned / steps / 1000 << " us/step"
+            << std::endl;
+  std::cout << "thread groups: " << grouped / steps / 1000 << " us/step"
+            << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+#include "property/column.h"
+
+// Checks range_scan, range_select and sorted_range of temporal columns
+// against a full scan, with and without a zone map. Columns are written under
+// the prefix argv[1].
+using Ranges = std::vector<std::pair<size_t, size_t>>;
+
+template <typename T>
+void check_column(const std::string& fname, const std::vector<T>& values,
+                  std::mt19937_64& rng) {
+  CHECK(ladder::dump_to_file(fname, values.data(), values.size()));
+  ladder::NumericColumn<T> plain, zoned;
+  plain.open(fname, ladder::StorageStrategy::kMemory);
+  zoned.open(fname, ladder::StorageStrategy::kMemory);
+  zoned.open_zone_map(fname, ladder::StorageStrategy::kMemory);
+  zoned.open_sorted_index(fname, ladder::StorageStrategy::kMemory);
+  CHECK(!plain.has_zone_map());
+  CHECK(zoned.has_zone_map());
+
+  std::vector<std::pair<int64_t, int64_t>> windows = {
+      {std::numeric_limits<int64_t>::min(),
+       std::numeric_limits<int64_t>::max()},
+      {1, 0},
+      {0, 0}};
+  for (int i = 0; i < 20 && !values.empty(); ++i) {
+    int64_t a = ladder::column_key(values[rng() % values.size()]);
+    int64_t b = ladder::column_key(values[rng() % values.size()]);
+    windows.emplace_back(std::min(a, b), std::max(a, b));
+  }
+
+  for (auto& window : windows) {
+    int64_t low = window.first, high = window.second;
+    Ranges expected;
+    std::vector<uint64_t> expected_bitmap((values.size() + 63) / 64, 0);
+    std::vector<std::pair<int64_t, size_t>> expected_sorted;
+    for (size_t i = 0; i < values.size(); ++i) {
+      int64_t key = ladder::column_key(values[i]);
+      if (key < low || key > high) {
+        continue;
+      }
+      if (!expected.empty() && expected.back().second == i) {
+        ++expected.back().second;
+      } else {
+        expected.emplace_back(i, i + 1);
+      }
+      expected_bitmap[i >> 6] |= 1ULL << (i & 63);
+      expected_sorted.emplace_back(key, i);
+    }
+    std::sort(expected_sorted.begin(), expected_sorted.end());
+
+    for (auto* column : {&plain, &zoned}) {
+      Ranges ranges;
+      column->range_scan(low, high, ranges);
+      CHECK(ranges == expected);
+      std::vector<uint64_t> bitmap;
+      column->range_select(low, high, bitmap);
+      CHECK(bitmap == expected_bitmap);
+    }
+
+    auto rows = zoned.sorted_range(low, high);
+    CHECK_EQ(static_cast<size_t>(rows.second - rows.first),
+             expected_sorted.size());
+    for (size_t i = 0; i < expected_sorted.size(); ++i) {
+      CHECK_EQ(rows.first[i], expected_sorted[i].second);
+    }
+  }
+}
+
+// Sorted runs fill whole zones inside a window, random values make boundary
+// zones, and the last zone is partial unless row_num is a multiple of
+// ZONE_SIZE.
+template <typename T>
+std::vector<T> make_values(size_t row_num, int64_t range,
+                           std::mt19937_64& rng) {
+  std::vector<T> values(row_num);
+  for (size_t i = 0; i < row_num; ++i) {
+    if ((i / ladder::NumericColumn<T>::ZONE_SIZE) % 2 == 0) {
+      values[i] = T(static_cast<int64_t>(i % range) - range / 2);
+    } else {
+      values[i] = T(static_cast<int64_t>(rng() % range) - range / 2);
+    }
+  }
+  return values;
+}
+
+int main(int argc, char** argv) {
+  std::string prefix = argv[1];
+  std::mt19937_64 rng(7);
+  constexpr size_t ZONE_SIZE = ladder::NumericColumn<ladder::Date>::ZONE_SIZE;
+  for (size_t row_num :
+       {size_t(0), size_t(1), ZONE_SIZE - 1, ZONE_SIZE, 3 * ZONE_SIZE + 17}) {
+    check_column(prefix + "_date",
+                 make_values<ladder::Date>(row_num, 5000, rng), rng);
+    check_column(prefix + "_datetime",
+                 make_values<ladder::DateTime>(row_num, 1LL << 40, rng), rng);
+    LOG(INFO) << "checked " << row_num << " rows";
+  }
+
+  return 0;
+}
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "graph/compact_csr.h"
+#include "graph/compressed_csr.h"
+#include "graph/csr.h"
+#include "graph/graph_view.h"
+#include "graph/intersect.h"
+
+std::vector<ladder::gid_t> to_vector(const ladder::CompressedAdjList& list) {
+  std::vector<ladder::gid_t> ret;
+  for (auto nbr : list) {
+    ret.push_back(nbr);
+  }
+  return ret;
+}
+
+int main(int argc, char** argv) {
+  std::string prefix = argv[1];
+  ladder::Csr csr;
+  csr.open(prefix, ladder::StorageStrategy::kMemory,
+           ladder::NeighborEncoding::kGlobal);
+  ladder::CompactCsr compact_csr;
+  compact_csr.open(prefix, ladder::StorageStrategy::kMemory,
+                   ladder::NeighborEncoding::kGlobal);
+  ladder::CompressedCsr compressed_csr;
+  compressed_csr.open(prefix, ladder::StorageStrategy::kMemory,
+                      ladder::NeighborEncoding::kGlobal);
+
+  CHECK_EQ(csr.vertex_num(), compact_csr.vertex_num());
+  CHECK_EQ(csr.edge_num(), compact_csr.edge_num());
+  CHECK_EQ(csr.vertex_num(), compressed_csr.vertex_num());
+  for (ladder::vertex_t u = 0; u < csr.vertex_num(); ++u) {
+    CHECK_EQ(csr.degree(u), compact_csr.degree(u));
+    CHECK_EQ(csr.degree(u), compressed_csr.degree(u));
+    auto expected = csr.get_edges(u).begin();
+    for (auto nbr : compact_csr.get_edges(u)) {
+      CHECK_EQ(*expected, nbr);
+      ++expected;
+    }
+
+    std::vector<ladder::gid_t> sorted;
+    for (auto nbr : csr.get_edges(u)) {
+      sorted.push_back(nbr);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<ladder::gid_t> decoded;
+    for (auto nbr : compressed_csr.get_compressed_edges(u)) {
+      decoded.push_back(nbr);
+    }
+    CHECK(sorted == decoded);
+    decoded.clear();
+    for (int part_i = 0; part_i < 3; ++part_i) {
+      for (auto nbr :
+           compressed_csr.get_compressed_partial_edges(u, part_i, 3)) {
+        decoded.push_back(nbr);
+      }
+    }
+    CHECK(sorted == decoded);
+  }
+
+  // Decoded lists point into the csr, so earlier ones survive later decodes.
+  // The second open maps the encoding dumped in between.
+  CHECK(ladder::CompressedCsr::dump(prefix, ladder::NeighborEncoding::kGlobal));
+  ladder::CompressedCsr mapped_csr;
+  mapped_csr.open(prefix, ladder::StorageStrategy::kMmap,
+                  ladder::NeighborEncoding::kGlobal);
+  ladder::CompressedGraphView view(&compressed_csr);
+  ladder::CompressedGraphView mapped_view(&mapped_csr);
+  CHECK_EQ(mapped_csr.memory_usage(), compressed_csr.memory_usage());
+  if (csr.vertex_num() >= 2) {
+    auto first = view.get_edges(0);
+    auto second = mapped_view.get_edges(1);
+    std::vector<ladder::gid_t> first_copy = to_vector(first);
+    std::vector<ladder::gid_t> second_copy = to_vector(second);
+    for (ladder::vertex_t u = 0; u < csr.vertex_num(); ++u) {
+      CHECK(to_vector(view.get_edges(u)) ==
+            to_vector(mapped_view.get_edges(u)));
+      CHECK_EQ(view.degree(u), mapped_view.degree(u));
+    }
+    CHECK(to_vector(first) == first_copy);
+    CHECK(to_vector(second) == second_copy);
+  }
+
+  ladder::Csr sorted_csr;
+  sorted_csr.open(prefix, ladder::StorageStrategy::kMemory,
+                  ladder::NeighborEncoding::kGlobal);
+  sorted_csr.sort_neighbors();
+  for (ladder::vertex_t u = 0; u < csr.vertex_num(); ++u) {
+    for (auto nbr : csr.get_edges(u)) {
+      CHECK(sorted_csr.has_edge(u, nbr));
+      CHECK(compressed_csr.has_edge(u, nbr));
+    }
+    CHECK(!sorted_csr.has_edge(u, std::numeric_limits<ladder::gid_t>::max()));
+  }
+
+  // Lists sorted offline, and compact layouts written offline, are mapped as
+  // they are. They are written for a copy of the csr under prefix +
+  // "_offline", whose lists are laid out in reverse vertex order, so that
+  // CompactCsr::dump has to repack them.
+  std::string offline_prefix = prefix + "_offline";
+  std::vector<ladder::gid_t> reversed;
+  std::vector<size_t> offsets(csr.vertex_num());
+  std::vector<int> degree(csr.vertex_num());
+  for (ladder::vertex_t u = csr.vertex_num(); u-- > 0;) {
+    auto edges = csr.get_edges(u);
+    offsets[u] = reversed.size();
+    degree[u] = edges.size();
+    reversed.insert(reversed.end(), edges.data(),
+                    edges.data() + edges.size());
+  }
+  std::vector<size_t> meta = {csr.edge_num()};
+  CHECK(ladder::dump_to_file(offline_prefix + "_nbrs", reversed.data(),
+                             reversed.size()));
+  CHECK(ladder::dump_to_file(offline_prefix + "_offsets", offsets.data(),
+                             offsets.size()));
+  CHECK(ladder::dump_to_file(offline_prefix + "_degree", degree.data(),
+                             degree.size()));
+  CHECK(ladder::dump_to_file(offline_prefix + "_meta", meta.data(),
+                             meta.size()));
+  CHECK(ladder::Csr::sort_lists(offline_prefix,
+                                ladder::NeighborEncoding::kGlobal));
+  CHECK(ladder::CompactCsr::dump(offline_prefix));
+  ladder::Csr mapped_sorted_csr;
+  mapped_sorted_csr.open(offline_prefix, ladder::StorageStrategy::kMmap,
+                         ladder::NeighborEncoding::kGlobal);
+  ladder::CompactCsr compact_sorted_csr;
+  compact_sorted_csr.open(offline_prefix, ladder::StorageStrategy::kMmap,
+                          ladder::NeighborEncoding::kGlobal);
+  CHECK(!csr.is_sorted());
+  CHECK(mapped_sorted_csr.is_sorted());
+  CHECK(compact_sorted_csr.is_sorted());
+  CHECK_EQ(compact_sorted_csr.memory_usage(), compact_csr.memory_usage());
+  for (ladder::vertex_t u = 0; u < csr.vertex_num(); ++u) {
+    auto expected = sorted_csr.get_edges(u);
+    auto mapped = mapped_sorted_csr.get_edges(u);
+    auto compact = compact_sorted_csr.get_edges(u);
+    CHECK(std::equal(expected.data(), expected.data() + expected.size(),
+                     mapped.data(), mapped.data() + mapped.size()));
+    CHECK(std::equal(expected.data(), expected.data() + expected.size(),
+                     compact.data(), compact.data() + compact.size()));
+  }
+
+  for (ladder::vertex_t u = 0; u + 1 < csr.vertex_num(); ++u) {
+    auto a = sorted_csr.get_edges(u);
+    auto b = sorted_csr.get_edges(u + 1);
+    std::vector<ladder::gid_t> a_set(a.data(), a.data() + a.size());
+    a_set.erase(std::unique(a_set.begin(), a_set.end()), a_set.end());
+    std::vector<ladder::gid_t> b_set(b.data(), b.data() + b.size());
+    b_set.erase(std::unique(b_set.begin(), b_set.end()), b_set.end());
+    std::vector<ladder::gid_t> expected, got;
+    std::set_intersection(a_set.begin(), a_set.end(), b_set.begin(),
+                          b_set.end(), std::back_inserter(expected));
+    ladder::intersect(ladder::AdjList(a_set.data(), a_set.size()),
+                      ladder::AdjList(b_set.data(), b_set.size()), got);
+    CHECK(expected == got);
+  }
+
+  LOG(INFO) << "vertex num: " << csr.vertex_num()
+            << ", edge num: " << csr.edge_num();
+  LOG(INFO) << "Csr: " << csr.memory_usage() << " bytes";
+  LOG(INFO) << "CompactCsr: " << compact_csr.memory_usage() << " bytes";
+  LOG(INFO) << "CompressedCsr: " << compressed_csr.memory_usage() << " bytes";
+
+  return 0;
+}
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+#include "property/column.h"
+#include "property/encoding.h"
+
+// Encodes columns with each of for, rle and dict, and checks get, gather and
+// select_between of the encoded column against the plain values. Columns are
+// written under the prefix argv[1].
+template <typename T>
+std::vector<size_t> scalar_between(const std::vector<T>& values, T low,
+                                   T high) {
+  std::vector<size_t> rows;
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (values[i] >= low && values[i] <= high) {
+      rows.push_back(i);
+    }
+  }
+  return rows;
+}
+
+// Windows at the bounds, around each distinct value so that dictionary code
+// ranges start and end on and between codes, and empty ones.
+template <typename T>
+std::vector<std::pair<T, T>> make_windows(const std::vector<T>& values,
+                                          std::mt19937_64& rng) {
+  T min = std::numeric_limits<T>::lowest(), max = std::numeric_limits<T>::max();
+  std::vector<std::pair<T, T>> windows = {
+      {min, max}, {min, min}, {max, max}, {max, min}};
+  for (int i = 0; i < 10 && !values.empty(); ++i) {
+    T a = values[rng() % values.size()], b = values[rng() % values.size()];
+    if (b < a) {
+      std::swap(a, b);
+    }
+    windows.emplace_back(a, b);
+    if (a != max && b != min) {
+      windows.emplace_back(a + 1, b - 1);
+    }
+    windows.emplace_back(min, a);
+    windows.emplace_back(b, max);
+  }
+  return windows;
+}
+
+template <typename T>
+void check_encoding(const std::string& prefix, const std::vector<T>& values,
+                    ladder::ColumnEncoding encoding, std::mt19937_64& rng) {
+  ladder::ColumnEncoder<T> encoder(values);
+  if (encoder.encoded_size(encoding) == std::numeric_limits<size_t>::max()) {
+    return;
+  }
+  CHECK(ladder::dump_to_file(prefix, values.data(), values.size()));
+  std::remove((prefix + "_meta").c_str());
+  CHECK(encoder.dump(prefix, encoding));
+
+  ladder::NumericColumn<T> column;
+  column.open(prefix, ladder::StorageStrategy::kMemory);
+  CHECK(column.encoding() == encoding) << ladder::encoding_name(encoding);
+  CHECK_EQ(column.size(), values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    CHECK(column.get(i) == values[i])
+        << ladder::encoding_name(encoding) << " row " << i;
+  }
+
+  std::vector<size_t> rows;
+  for (size_t i = 0; i < values.size(); ++i) {
+    rows.push_back(rng() % values.size());
+  }
+  // Random rows, then ascending ones as selection vectors hold them.
+  std::vector<T> out(rows.size());
+  for (int pass = 0; pass < 2; ++pass) {
+    column.gather(rows.data(), rows.size(), out.data());
+    for (size_t i = 0; i < rows.size(); ++i) {
+      CHECK(out[i] == values[rows[i]]);
+    }
+    std::sort(rows.begin(), rows.end());
+  }
+
+  for (auto& window : make_windows(values, rng)) {
+    std::vector<size_t> selected;
+    column.select_between(window.first, window.second, selected);
+    CHECK(selected == scalar_between(values, window.first, window.second))
+        << ladder::encoding_name(encoding) << " [" << window.first << ", "
+        << window.second << "]";
+  }
+}
+
+template <typename T>
+void check_values(const std::string& prefix, const std::vector<T>& values,
+                  std::mt19937_64& rng) {
+  for (auto encoding : {ladder::ColumnEncoding::kFor,
+                        ladder::ColumnEncoding::kRle,
+                        ladder::ColumnEncoding::kDict}) {
+    check_encoding(prefix, values, encoding, rng);
+  }
+}
+
+// Values of [base, base + span) in runs of up to max_run equal values. The
+// size is not a multiple of the decoding block.
+template <typename T>
+std::vector<T> make_values(T base, uint64_t span, size_t max_run,
+                           std::mt19937_64& rng) {
+  std::vector<T> values;
+  while (values.size() < 2500) {
+    uint64_t offset = span == 0 ? rng() : rng() % span;
+    T value = static_cast<T>(static_cast<uint64_t>(base) + offset);
+    size_t run = 1 + rng() % max_run;
+    values.insert(values.end(), std::min(run, 2500 - values.size()), value);
+  }
+  return values;
+}
+
+// Run-length encoding is only chosen for long runs, however small it is.
+template <typename T>
+void check_choose(std::mt19937_64& rng) {
+  CHECK(ladder::ColumnEncoder<T>(make_values<T>(0, 1000, 4, rng)).choose() !=
+        ladder::ColumnEncoding::kRle);
+  CHECK(ladder::ColumnEncoder<T>(make_values<T>(0, 1ULL << 40, 200, rng))
+            .choose() == ladder::ColumnEncoding::kRle);
+}
+
+template <typename T>
+void check_type(const std::string& prefix, std::mt19937_64& rng) {
+  T min = std::numeric_limits<T>::lowest(), max = std::numeric_limits<T>::max();
+  check_values(prefix, std::vector<T>{}, rng);
+  check_values(prefix, std::vector<T>{-7}, rng);
+  // Negative frame bases, with widths that do and do not divide 64.
+  check_values(prefix, make_values<T>(-1000, 100, 1, rng), rng);
+  check_values(prefix, make_values<T>(-3, 1ULL << 7, 1, rng), rng);
+  check_values(prefix, make_values<T>(min, 1ULL << 31, 1, rng), rng);
+  // Runs, and few distinct values at the bounds for dictionaries.
+  check_values(prefix, make_values<T>(-50, 100, 40, rng), rng);
+  std::vector<T> extremes;
+  for (size_t i = 0; i < 1500; ++i) {
+    T choices[] = {min, max, 0, -1, 1};
+    extremes.push_back(choices[rng() % 5]);
+  }
+  check_values(prefix, extremes, rng);
+  check_choose<T>(rng);
+}
+
+int main(int argc, char** argv) {
+  std::string prefix = argv[1];
+  std::mt19937_64 rng(23);
+  check_type<int32_t>(prefix, rng);
+  check_type<int64_t>(prefix, rng);
+  // Width 33 and 63 values straddle words, width 64 spans the whole type.
+  check_values(prefix, make_values<int64_t>(-5, 1ULL << 33, 1, rng), rng);
+  check_values(prefix,
+               make_values<int64_t>(std::numeric_limits<int64_t>::min() / 2,
+                                    1ULL << 63, 1, rng),
+               rng);
+  check_values(prefix,
+               make_values<int64_t>(std::numeric_limits<int64_t>::min(), 0, 1,
+                                    rng),
+               rng);
+  LOG(INFO) << "checked column encodings";
+
+  return 0;
+}
@@ -6,6 +6,14 @@ int main(int argc, char** argv) {
   std::string prefix = argv[1];
   int partition_id = atoi(argv[2]);
   int partition_num = atoi(argv[3]);
+  ladder::StorageStrategy strategy = ladder::StorageStrategy::kMemory;
+  if (argc > 4 && std::string(argv[4]) == "mmap") {
+    strategy = ladder::StorageStrategy::kMmap;
+  }
+  int thread_num = std::thread::hardware_concurrency();
+  if (argc > 5) {
+    thread_num = atoi(argv[5]);
+  }
   ladder::GraphDB graph;
-  graph.open(prefix, partition_id, partition_num);
+  graph.open(prefix, partition_id, partition_num, strategy, thread_num);
 }
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+#include "property/select.h"
+#include "property/table.h"
+
+// Checks the scan kernels of property/select.h, and the NumericColumn and
+// Table accessors and index lookups, against scalar loops. Sizes are not
+// multiples of the vector width, and values include the numeric_limits
+// bounds that select_less relies on. Columns are written under the prefix
+// argv[1].
+template <typename T>
+std::vector<size_t> scalar_between(const std::vector<T>& data, T low, T high) {
+  std::vector<size_t> rows;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (data[i] >= low && data[i] <= high) {
+      rows.push_back(i);
+    }
+  }
+  return rows;
+}
+
+template <typename T>
+std::vector<size_t> scalar_less(const std::vector<T>& data, T value) {
+  std::vector<size_t> rows;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (data[i] < value) {
+      rows.push_back(i);
+    }
+  }
+  return rows;
+}
+
+template <typename T>
+std::vector<T> make_data(size_t size, std::mt19937_64& rng) {
+  std::vector<T> data(size);
+  for (size_t i = 0; i < size; ++i) {
+    switch (rng() % 8) {
+    case 0:
+      data[i] = std::numeric_limits<T>::lowest();
+      break;
+    case 1:
+      data[i] = std::numeric_limits<T>::max();
+      break;
+    default:
+      data[i] = static_cast<T>(static_cast<int64_t>(rng() % 64) - 32);
+    }
+  }
+  return data;
+}
+
+// Windows and thresholds at the bounds, inside the data and empty.
+template <typename T>
+std::vector<std::pair<T, T>> make_windows() {
+  T min = std::numeric_limits<T>::lowest();
+  T max = std::numeric_limits<T>::max();
+  T zero = static_cast<T>(0), five = static_cast<T>(5);
+  return {{min, max}, {min, min},     {max, max},    {min, zero},
+          {zero, max}, {-five, five}, {five, -five}};
+}
+
+template <typename T>
+void check_kernels(std::mt19937_64& rng) {
+  for (size_t size : {0, 1, 3, 4, 7, 8, 9, 15, 17, 33, 1001}) {
+    std::vector<T> data = make_data<T>(size, rng);
+    for (auto& window : make_windows<T>()) {
+      std::vector<size_t> rows;
+      ladder::select_between(data.data(), data.size(), window.first,
+                             window.second, rows);
+      CHECK(rows == scalar_between(data, window.first, window.second));
+      for (T value : {window.first, window.second}) {
+        rows.clear();
+        ladder::select_less(data.data(), data.size(), value, rows);
+        CHECK(rows == scalar_less(data, value));
+        rows.clear();
+        ladder::select_equal(data.data(), data.size(), value, rows);
+        CHECK(rows == scalar_between(data, value, value));
+      }
+    }
+
+    std::vector<size_t> rows;
+    for (size_t i = 0; i < size; ++i) {
+      rows.push_back(rng() % size);
+    }
+    std::vector<T> out(rows.size());
+    ladder::gather(data.data(), rows.data(), rows.size(), out.data());
+    for (size_t i = 0; i < rows.size(); ++i) {
+      CHECK(out[i] == data[rows[i]]);
+    }
+  }
+}
+
+void check_select_equal_u16(std::mt19937_64& rng) {
+  for (size_t size : {0, 1, 15, 16, 17, 31, 1001}) {
+    std::vector<uint16_t> data(size);
+    for (auto& value : data) {
+      value = rng() % 4 == 0 ? 0xffff : rng() % 8;
+    }
+    for (uint16_t value : {0, 3, 0xffff}) {
+      std::vector<size_t> rows;
+      ladder::select_equal(data.data(), data.size(), value, rows);
+      CHECK(rows == scalar_between<uint16_t>(data, value, value));
+    }
+  }
+}
+
+void check_selections(std::mt19937_64& rng) {
+  for (size_t row_num : {0, 1, 63, 64, 65, 1001}) {
+    std::vector<bool> in_a(row_num), in_b(row_num);
+    std::vector<size_t> a, b, both, either;
+    for (size_t i = 0; i < row_num; ++i) {
+      in_a[i] = rng() % 3 == 0;
+      in_b[i] = rng() % 2 == 0;
+      if (in_a[i]) {
+        a.push_back(i);
+      }
+      if (in_b[i]) {
+        b.push_back(i);
+      }
+      if (in_a[i] && in_b[i]) {
+        both.push_back(i);
+      }
+      if (in_a[i] || in_b[i]) {
+        either.push_back(i);
+      }
+    }
+
+    std::vector<size_t> out;
+    ladder::selection_and(a, b, out);
+    CHECK(out == both);
+    ladder::selection_or(a, b, out);
+    CHECK(out == either);
+
+    std::vector<uint64_t> bitmap_a, bitmap_b, bitmap;
+    ladder::selection_to_bitmap(a, row_num, bitmap_a);
+    ladder::selection_to_bitmap(b, row_num, bitmap_b);
+    CHECK_EQ(bitmap_a.size(), (row_num + 63) / 64);
+    out.clear();
+    ladder::bitmap_to_selection(bitmap_a, out);
+    CHECK(out == a);
+
+    bitmap = bitmap_a;
+    ladder::bitmap_and(bitmap, bitmap_b);
+    out.clear();
+    ladder::bitmap_to_selection(bitmap, out);
+    CHECK(out == both);
+    bitmap = bitmap_a;
+    ladder::bitmap_or(bitmap, bitmap_b);
+    out.clear();
+    ladder::bitmap_to_selection(bitmap, out);
+    CHECK(out == either);
+  }
+}
+
+template <typename T>
+void check_column(const ladder::NumericColumn<T>& column,
+                  const std::vector<T>& data, std::mt19937_64& rng) {
+  for (auto& window : make_windows<T>()) {
+    std::vector<size_t> rows;
+    column.select_between(window.first, window.second, rows);
+    CHECK(rows == scalar_between(data, window.first, window.second));
+    rows.clear();
+    column.select_less(window.first, rows);
+    CHECK(rows == scalar_less(data, window.first));
+    rows.clear();
+    column.select_equal(window.second, rows);
+    CHECK(rows == scalar_between(data, window.second, window.second));
+  }
+
+  std::vector<size_t> input;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (rng() % 2 == 0) {
+      input.push_back(i);
+    }
+  }
+  std::vector<T> out(input.size());
+  column.gather(input.data(), input.size(), out.data());
+  std::vector<size_t> rows, expected;
+  for (size_t i = 0; i < input.size(); ++i) {
+    CHECK(out[i] == data[input[i]]);
+    if (data[input[i]] > 0) {
+      expected.push_back(input[i]);
+    }
+  }
+  column.refine(input, [](T value) { return value > 0; }, rows);
+  CHECK(rows == expected);
+}
+
+void check_table(const std::string& prefix, std::mt19937_64& rng) {
+  // More rows than one refine block, and not a multiple of it.
+  size_t row_num = 1001;
+  std::vector<int32_t> ints = make_data<int32_t>(row_num, rng);
+  std::vector<int64_t> longs = make_data<int64_t>(row_num, rng);
+  std::vector<double> doubles = make_data<double>(row_num, rng);
+  CHECK(ladder::dump_to_file(prefix + "_col_0", ints.data(), ints.size()));
+  CHECK(ladder::dump_to_file(prefix + "_col_1", longs.data(), longs.size()));
+  CHECK(ladder::dump_to_file(prefix + "_col_2", doubles.data(),
+                             doubles.size()));
+
+  ladder::Table table;
+  table.open(prefix,
+             {{"ints", ladder::DataType::kInt32},
+              {"longs", ladder::DataType::kInt64},
+              {"doubles", ladder::DataType::kDouble}},
+             ladder::StorageStrategy::kMemory);
+  CHECK(table.get_numeric_column<int64_t>("ints") == nullptr);
+  CHECK(table.get_numeric_column<int32_t>("missing") == nullptr);
+  auto* int_column = table.get_numeric_column<int32_t>("ints");
+  auto* long_column = table.get_numeric_column<int64_t>("longs");
+  auto* double_column = table.get_numeric_column<double>("doubles");
+  CHECK(int_column != nullptr);
+  CHECK(long_column != nullptr);
+  CHECK(double_column != nullptr);
+  check_column(*int_column, ints, rng);
+  check_column(*long_column, longs, rng);
+  check_column(*double_column, doubles, rng);
+
+  // Secondary index lookups against select_equal, built and then mapped.
+  table.open_index(prefix, 0, ladder::StorageStrategy::kMemory);
+  CHECK(table.dump_index(prefix, 0));
+  ladder::Table mapped;
+  mapped.open(prefix, {{"ints", ladder::DataType::kInt32}},
+              ladder::StorageStrategy::kMmap);
+  mapped.open_index(prefix, 0, ladder::StorageStrategy::kMmap);
+  for (auto* t : {&table, &mapped}) {
+    for (int32_t value : {std::numeric_limits<int32_t>::lowest(),
+                          std::numeric_limits<int32_t>::max(), 0, -32, 31,
+                          1000}) {
+      std::vector<size_t> rows;
+      CHECK(t->lookup("ints", value, rows));
+      CHECK(rows == scalar_between(ints, value, value));
+    }
+    std::vector<size_t> rows;
+    CHECK(!t->lookup("ints", std::string_view("0"), rows));
+    CHECK(!t->lookup("longs", 0, rows));
+    CHECK(rows.empty());
+  }
+}
+
+int main(int argc, char** argv) {
+  std::string prefix = argv[1];
+  std::mt19937_64 rng(17);
+  check_kernels<int32_t>(rng);
+  check_kernels<int64_t>(rng);
+  check_kernels<double>(rng);
+  check_select_equal_u16(rng);
+  check_selections(rng);
+  check_table(prefix, rng);
+  LOG(INFO) << "checked select kernels";
+
+  return 0;
+}